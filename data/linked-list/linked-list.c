@@ -1,13 +1,35 @@
 #include <linux/module.h>
+#include <linux/moduleparam.h>
 #include <linux/kernel.h>
 #include <linux/list.h>
+#include <linux/hashtable.h>
+#include <linux/jhash.h>
 #include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/random.h>
+#include <linux/ktime.h>
+#include <linux/mm.h>
 
 #include "utils.h"
 
+/*
+ * With 'bench' set, lookups by breed through the list walk and through the
+ * hashtable are timed with 1K, 100K and 1M dogs in the list:
+ * insmod linked-list.ko bench=1 bench_lookups=1000
+ */
+static bool bench;
+module_param(bench, bool, 0444);
+MODULE_PARM_DESC(bench, "Time lookups by breed, list walk versus hashtable");
+
+static unsigned int bench_lookups = 1000;
+module_param(bench_lookups, uint, 0444);
+MODULE_PARM_DESC(bench_lookups, "Hashtable lookups per list size");
+
 /* Dummy structure to examplify the linked list */
 struct dog {
 	struct list_head list;
+	/* Bucket of dog_table the dog is hashed in, by breed */
+	struct hlist_node node;
 	char *breed;
 	int age; /* in months */
 	bool training_easy;
@@ -15,21 +37,193 @@ struct dog {
 
 LIST_HEAD(dog_list);
 
-static int __init linked_list_init(void)
+/*
+ * The list keeps the dogs in insertion order, but finding one by breed means
+ * walking it from the head. dog_table indexes the very same dogs by a hash
+ * of their breed: DEFINE_HASHTABLE() declares an array of 2^DOG_HASH_BITS
+ * hlist heads (a single pointer each, half the size of a list_head), and a
+ * lookup only walks the dogs that fell in the same bucket. With a few dogs
+ * per bucket that's about constant time, 1M dogs make for 16 per bucket.
+ */
+#define DOG_HASH_BITS	16
+static DEFINE_HASHTABLE(dog_table, DOG_HASH_BITS);
+
+/* Large enough for the "breed-%u" names of the benchmark */
+#define DOG_BREED_LEN	16
+
+static u32 dog_hash(const char *breed)
 {
-	struct dog *my_dog;
+	return jhash(breed, strlen(breed), 0);
+}
 
-	/* Structure initialization */
-	my_dog = (struct dog *) kmalloc(sizeof(struct dog), GFP_KERNEL);
-	my_dog->breed = "Golden Retriever";
-	my_dog->age = 2;
-	my_dog->training_easy = true;
+/*
+ * Add a new dog in the tail of the list and in the hashtable. The breed is
+ * copied, the caller's string can go away.
+ */
+static struct dog *dog_insert(const char *breed, int age, bool training_easy)
+{
+	struct dog *dog;
+
+	dog = kmalloc(sizeof(*dog), GFP_KERNEL);
+	if (!dog)
+		return NULL;
+
+	dog->breed = kstrdup(breed, GFP_KERNEL);
+	if (!dog->breed) {
+		kfree(dog);
+		return NULL;
+	}
+	dog->age = age;
+	dog->training_easy = training_easy;
 
 	/*
 	 * Add new node in the tail of the list (before head), this way the list
 	 * behaves like a queue (FIFO) data structure.
 	 */
-	list_add_tail(&my_dog->list, &dog_list);
+	list_add_tail(&dog->list, &dog_list);
+	/*
+	 * hash_add() reduces the 32 bits key to DOG_HASH_BITS and adds the node
+	 * in the head of that bucket.
+	 */
+	hash_add(dog_table, &dog->node, dog_hash(breed));
+	return dog;
+}
+
+/* Remove a dog from both the list and the hashtable and free it */
+static void dog_delete(struct dog *dog)
+{
+	list_del(&dog->list);
+	hash_del(&dog->node);
+	kfree(dog->breed);
+	kfree(dog);
+}
+
+/*
+ * A dog of the given breed, or NULL. hash_for_each_possible() walks the
+ * bucket the key maps to, which also holds dogs of other breeds whose hash
+ * collide, thus the breed must still be compared.
+ */
+static struct dog *dog_lookup(const char *breed)
+{
+	struct dog *dog;
+
+	hash_for_each_possible(dog_table, dog, node, dog_hash(breed)) {
+		if (!strcmp(dog->breed, breed))
+			return dog;
+	}
+	return NULL;
+}
+
+/* Same as dog_lookup(), walking the whole list: O(n) */
+static struct dog *dog_lookup_list(const char *breed)
+{
+	struct dog *dog;
+
+	list_for_each_entry(dog, &dog_list, list) {
+		if (!strcmp(dog->breed, breed))
+			return dog;
+	}
+	return NULL;
+}
+
+/*
+ * Insert 'nr' dogs, look up random ones by breed through both indexes and
+ * delete them again. The list walk takes n/2 steps on average, it gets fewer
+ * lookups as the list grows so 1M dogs don't take minutes.
+ */
+static int dog_bench(unsigned int nr)
+{
+	unsigned int i, list_lookups;
+	char (*keys)[DOG_BREED_LEN];
+	struct dog **dogs, *dog;
+	u64 start, list_ns, hash_ns;
+	char breed[DOG_BREED_LEN];
+	int err = 0;
+
+	list_lookups = max_t(u64, (u64)bench_lookups * 1000 / nr, 10);
+	list_lookups = min(list_lookups, bench_lookups);
+	dogs = kvmalloc_array(nr, sizeof(*dogs), GFP_KERNEL);
+	keys = kvmalloc_array(bench_lookups, sizeof(*keys), GFP_KERNEL);
+	if (!dogs || !keys) {
+		err = -ENOMEM;
+		goto out;
+	}
+
+	for (i = 0; i < nr; i++) {
+		snprintf(breed, sizeof(breed), "breed-%u", i);
+		dogs[i] = dog_insert(breed, i % 200, i & 1);
+		if (!dogs[i]) {
+			err = -ENOMEM;
+			goto out_delete;
+		}
+		if (!(i & 0xffff))
+			cond_resched();
+	}
+	/* Keys are separate strings, as a caller would have them */
+	for (i = 0; i < bench_lookups; i++)
+		snprintf(keys[i], DOG_BREED_LEN, "breed-%u",
+			 get_random_u32_below(nr));
+
+	start = ktime_get_ns();
+	for (i = 0; i < list_lookups; i++) {
+		dog = dog_lookup_list(keys[i]);
+		if (!dog || strcmp(dog->breed, keys[i]))
+			err = -EINVAL;
+		cond_resched();
+	}
+	list_ns = ktime_get_ns() - start;
+
+	start = ktime_get_ns();
+	for (i = 0; i < bench_lookups; i++) {
+		dog = dog_lookup(keys[i]);
+		if (!dog || strcmp(dog->breed, keys[i]))
+			err = -EINVAL;
+	}
+	hash_ns = ktime_get_ns() - start;
+
+	i = nr;
+	if (err) {
+		PR_ERROR("%u dogs: lookup returned the wrong dog\n", nr);
+		goto out_delete;
+	}
+	PR_DEBUG("%7u dogs: list walk %llu ns/lookup (%u lookups), hashtable "
+		 "%llu ns/lookup (%u lookups)\n", nr,
+		 div_u64(list_ns, list_lookups), list_lookups,
+		 div_u64(hash_ns, bench_lookups), bench_lookups);
+
+out_delete:
+	while (i--) {
+		dog_delete(dogs[i]);
+		if (!(i & 0xffff))
+			cond_resched();
+	}
+out:
+	kvfree(keys);
+	kvfree(dogs);
+	return err;
+}
+
+static int __init linked_list_init(void)
+{
+	static const unsigned int bench_sizes[] = { 1000, 100000, 1000000 };
+	struct dog *my_dog;
+	unsigned int i;
+	int err;
+
+	/* Structure initialization */
+	my_dog = dog_insert("Golden Retriever", 2, true);
+	if (!my_dog)
+		return -ENOMEM;
+
+	if (bench && bench_lookups) {
+		for (i = 0; i < ARRAY_SIZE(bench_sizes); i++) {
+			err = dog_bench(bench_sizes[i]);
+			if (err) {
+				dog_delete(my_dog);
+				return err;
+			}
+		}
+	}
 
 	PR_DEBUG("module loaded\n");
 	return 0;
@@ -37,7 +231,7 @@ static int __init linked_list_init(void)
 
 static void __exit linked_list_exit(void)
 {
-	struct dog *entry;
+	struct dog *entry, *tmp;
 
 	/*
 	 * The call to list_for_each_entry() returns the node structure after
@@ -56,6 +250,10 @@ static void __exit linked_list_exit(void)
 			 entry->training_easy ? "true" : "false");
 	}
 
+	/* The _safe variant keeps the next node aside, 'entry' is freed */
+	list_for_each_entry_safe(entry, tmp, &dog_list, list)
+		dog_delete(entry);
+
 	PR_DEBUG("module unloaded\n");
 }
 
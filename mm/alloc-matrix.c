@@ -0,0 +1,357 @@
+/*
+ * Copyright (c) 2026 Bruno E. O. Meneguele <bmeneguele@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 2 as published by the
+ * Free Software Foundation.
+ */
+
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/gfp.h>
+#include <linux/mm.h>
+#include <linux/sort.h>
+#include <linux/mutex.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/ktime.h>
+
+#include "utils.h"
+
+/*
+ * Allocation latency matrix: every allocator below is exercised for every
+ * object size from 8 bytes to 4 MiB (powers of two) and every GFP mask, each
+ * cell being 'iterations' alloc/free pairs. The alloc call alone is timed, so
+ * the percentiles are allocation latencies, while the throughput counts whole
+ * alloc+free pairs per second.
+ *
+ * Results are exported through debugfs:
+ * # cat /sys/kernel/debug/alloc-matrix/table
+ * # echo 1 > /sys/kernel/debug/alloc-matrix/run
+ */
+static unsigned int iterations = 1000;
+module_param(iterations, uint, 0644);
+MODULE_PARM_DESC(iterations, "Alloc/free pairs measured per matrix cell");
+
+#define MATRIX_MIN_SHIFT	3	/* 8 B */
+#define MATRIX_MAX_SHIFT	22	/* 4 MiB */
+#define MATRIX_NR_SIZES		(MATRIX_MAX_SHIFT - MATRIX_MIN_SHIFT + 1)
+
+enum matrix_alloc {
+	MATRIX_KMALLOC,
+	MATRIX_KMEM_CACHE,
+	MATRIX_VMALLOC,
+	MATRIX_KVMALLOC,
+	MATRIX_ALLOC_PAGES,
+	MATRIX_NR_ALLOCS,
+};
+
+static const char * const matrix_alloc_names[] = {
+	[MATRIX_KMALLOC]	= "kmalloc",
+	[MATRIX_KMEM_CACHE]	= "kmem_cache",
+	[MATRIX_VMALLOC]	= "vmalloc",
+	[MATRIX_KVMALLOC]	= "kvmalloc",
+	[MATRIX_ALLOC_PAGES]	= "alloc_pages",
+};
+
+enum matrix_gfp {
+	MATRIX_GFP_KERNEL,
+	MATRIX_GFP_ATOMIC,
+	MATRIX_GFP_NOWAIT,
+	MATRIX_NR_GFPS,
+};
+
+static const struct {
+	const char *name;
+	gfp_t gfp;
+} matrix_gfps[] = {
+	[MATRIX_GFP_KERNEL]	= { "GFP_KERNEL", GFP_KERNEL },
+	[MATRIX_GFP_ATOMIC]	= { "GFP_ATOMIC", GFP_ATOMIC },
+	[MATRIX_GFP_NOWAIT]	= { "GFP_NOWAIT", GFP_NOWAIT },
+};
+
+enum matrix_status {
+	MATRIX_NOT_RUN,
+	MATRIX_OK,
+	/* The allocator can't serve this size or GFP mask at all */
+	MATRIX_UNSUPPORTED,
+};
+
+struct matrix_cell {
+	enum matrix_status status;
+	unsigned int failures;
+	u64 p50;
+	u64 p99;
+	u64 p999;
+	/* alloc+free pairs per second */
+	u64 ops;
+};
+
+static struct matrix_cell
+matrix[MATRIX_NR_ALLOCS][MATRIX_NR_GFPS][MATRIX_NR_SIZES];
+
+/* Serializes matrix runs against each other and against the table reader */
+static DEFINE_MUTEX(matrix_lock);
+
+static struct dentry *matrix_dir;
+
+/* State of the cell being measured */
+struct matrix_ctx {
+	enum matrix_alloc alloc;
+	gfp_t gfp;
+	size_t size;
+	unsigned int order;
+	unsigned int iterations;
+	struct kmem_cache *cache;
+};
+
+static bool matrix_supported(struct matrix_ctx *ctx)
+{
+	switch (ctx->alloc) {
+	case MATRIX_KMALLOC:
+		return ctx->size <= KMALLOC_MAX_SIZE;
+	case MATRIX_VMALLOC:
+		/* vmalloc may always sleep to allocate page tables */
+		return gfpflags_allow_blocking(ctx->gfp);
+	case MATRIX_ALLOC_PAGES:
+		return ctx->order <= MAX_PAGE_ORDER;
+	default:
+		return true;
+	}
+}
+
+static __always_inline void *matrix_alloc(struct matrix_ctx *ctx)
+{
+	struct page *page;
+
+	switch (ctx->alloc) {
+	case MATRIX_KMALLOC:
+		return kmalloc(ctx->size, ctx->gfp);
+	case MATRIX_KMEM_CACHE:
+		return kmem_cache_alloc(ctx->cache, ctx->gfp);
+	case MATRIX_VMALLOC:
+		return __vmalloc(ctx->size, ctx->gfp);
+	case MATRIX_KVMALLOC:
+		/* Non GFP_KERNEL compatible masks never fall back to vmalloc */
+		return kvmalloc(ctx->size, ctx->gfp);
+	case MATRIX_ALLOC_PAGES:
+		page = alloc_pages(ctx->gfp, ctx->order);
+		return page ? page_address(page) : NULL;
+	default:
+		return NULL;
+	}
+}
+
+static __always_inline void matrix_free(struct matrix_ctx *ctx, void *p)
+{
+	switch (ctx->alloc) {
+	case MATRIX_KMALLOC:
+		kfree(p);
+		break;
+	case MATRIX_KMEM_CACHE:
+		kmem_cache_free(ctx->cache, p);
+		break;
+	case MATRIX_VMALLOC:
+		vfree(p);
+		break;
+	case MATRIX_KVMALLOC:
+		kvfree(p);
+		break;
+	case MATRIX_ALLOC_PAGES:
+		free_pages((unsigned long)p, ctx->order);
+		break;
+	default:
+		break;
+	}
+}
+
+static int matrix_cmp_u64(const void *a, const void *b)
+{
+	u64 x = *(const u64 *)a, y = *(const u64 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/* 'permille' of the samples are below the returned value */
+static u64 matrix_percentile(u64 *samples, unsigned int n,
+			     unsigned int permille)
+{
+	unsigned int idx = div_u64((u64)n * permille, 1000);
+
+	return samples[min(idx, n - 1)];
+}
+
+static void matrix_run_cell(struct matrix_ctx *ctx, struct matrix_cell *cell,
+			    u64 *samples)
+{
+	unsigned int i, n = 0;
+	u64 start, t, total = 0;
+	void *p;
+
+	memset(cell, 0, sizeof(*cell));
+	if (!matrix_supported(ctx)) {
+		cell->status = MATRIX_UNSUPPORTED;
+		return;
+	}
+
+	if (ctx->alloc == MATRIX_KMEM_CACHE) {
+		ctx->cache = kmem_cache_create("alloc_matrix", ctx->size, 0,
+					       SLAB_NO_MERGE, NULL);
+		if (!ctx->cache) {
+			cell->status = MATRIX_UNSUPPORTED;
+			return;
+		}
+	}
+
+	for (i = 0; i < ctx->iterations; i++) {
+		start = ktime_get_ns();
+		p = matrix_alloc(ctx);
+		t = ktime_get_ns();
+		if (likely(p)) {
+			samples[n++] = t - start;
+			matrix_free(ctx, p);
+			total += ktime_get_ns() - start;
+		} else {
+			cell->failures++;
+		}
+		cond_resched();
+	}
+
+	if (ctx->alloc == MATRIX_KMEM_CACHE)
+		kmem_cache_destroy(ctx->cache);
+
+	cell->status = MATRIX_OK;
+	if (!n)
+		return;
+
+	sort(samples, n, sizeof(*samples), matrix_cmp_u64, NULL);
+	cell->p50 = matrix_percentile(samples, n, 500);
+	cell->p99 = matrix_percentile(samples, n, 990);
+	cell->p999 = matrix_percentile(samples, n, 999);
+	cell->ops = total ? div64_u64((u64)n * NSEC_PER_SEC, total) : 0;
+}
+
+static int matrix_run(void)
+{
+	struct matrix_ctx ctx = { };
+	unsigned int s;
+	u64 *samples;
+	int a, g;
+
+	/* 'iterations' is writable through sysfs, take a snapshot */
+	ctx.iterations = READ_ONCE(iterations);
+	if (!ctx.iterations)
+		return -EINVAL;
+
+	samples = kvmalloc_array(ctx.iterations, sizeof(*samples), GFP_KERNEL);
+	if (!samples)
+		return -ENOMEM;
+
+	mutex_lock(&matrix_lock);
+	for (a = 0; a < MATRIX_NR_ALLOCS; a++) {
+		for (g = 0; g < MATRIX_NR_GFPS; g++) {
+			for (s = 0; s < MATRIX_NR_SIZES; s++) {
+				ctx.alloc = a;
+				/* Failures are counted, not reported */
+				ctx.gfp = matrix_gfps[g].gfp |
+					  __GFP_NOWARN;
+				ctx.size = 1UL << (s + MATRIX_MIN_SHIFT);
+				ctx.order = get_order(ctx.size);
+				matrix_run_cell(&ctx, &matrix[a][g][s],
+						samples);
+			}
+		}
+		PR_DEBUG("%s done\n", matrix_alloc_names[a]);
+	}
+	mutex_unlock(&matrix_lock);
+
+	kvfree(samples);
+	return 0;
+}
+
+static int matrix_table_show(struct seq_file *m, void *v)
+{
+	struct matrix_cell *cell;
+	unsigned int s;
+	int a, g;
+
+	seq_printf(m, "%-12s %-10s %8s %10s %10s %10s %12s %8s\n", "allocator",
+		   "gfp", "size", "p50(ns)", "p99(ns)", "p99.9(ns)", "ops/s",
+		   "failed");
+
+	mutex_lock(&matrix_lock);
+	for (a = 0; a < MATRIX_NR_ALLOCS; a++) {
+		for (g = 0; g < MATRIX_NR_GFPS; g++) {
+			for (s = 0; s < MATRIX_NR_SIZES; s++) {
+				cell = &matrix[a][g][s];
+				seq_printf(m, "%-12s %-10s %8lu ",
+					   matrix_alloc_names[a],
+					   matrix_gfps[g].name,
+					   1UL << (s + MATRIX_MIN_SHIFT));
+				if (cell->status != MATRIX_OK) {
+					seq_puts(m, cell->status ==
+						 MATRIX_UNSUPPORTED ?
+						 "n/a\n" : "-\n");
+					continue;
+				}
+				seq_printf(m, "%10llu %10llu %10llu %12llu %8u\n",
+					   cell->p50, cell->p99, cell->p999,
+					   cell->ops, cell->failures);
+			}
+		}
+	}
+	mutex_unlock(&matrix_lock);
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(matrix_table);
+
+static ssize_t matrix_run_write(struct file *file, const char __user *buf,
+				size_t count, loff_t *ppos)
+{
+	int err;
+
+	err = matrix_run();
+	return err ? err : count;
+}
+
+static const struct file_operations matrix_run_fops = {
+	.owner = THIS_MODULE,
+	.write = matrix_run_write,
+};
+
+static int __init alloc_matrix_init(void)
+{
+	int err;
+
+	err = matrix_run();
+	if (err) {
+		PR_ERROR("matrix run failed: %d\n", err);
+		return err;
+	}
+
+	/* debugfs failures are not fatal, the module simply has no output */
+	matrix_dir = debugfs_create_dir("alloc-matrix", NULL);
+	debugfs_create_file("table", 0444, matrix_dir, NULL,
+			    &matrix_table_fops);
+	debugfs_create_file("run", 0200, matrix_dir, NULL, &matrix_run_fops);
+
+	PR_DEBUG("module loaded\n");
+	return 0;
+}
+
+static void __exit alloc_matrix_exit(void)
+{
+	debugfs_remove_recursive(matrix_dir);
+	PR_DEBUG("module unloaded\n");
+}
+
+module_init(alloc_matrix_init);
+module_exit(alloc_matrix_exit);
+
+MODULE_AUTHOR("Bruno E. O. Meneguele <bmeneguele@gmail.com>");
+MODULE_DESCRIPTION("Allocation latency matrix across kernel allocators");
+MODULE_LICENSE("GPL");
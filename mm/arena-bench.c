@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2026 Bruno E. O. Meneguele <bmeneguele@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 2 as published by the
+ * Free Software Foundation.
+ */
+
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/ktime.h>
+
+#include "utils.h"
+#include "bench.h"
+#include "arena.h"
+#include "my-alloc.h"
+
+/*
+ * Request scoped allocations: every "request" creates 'objs_per_request'
+ * struct test objects, touches them and drops all of them at the end. The
+ * kmalloc run frees one object at a time, the arena run resets the arena.
+ *
+ * Example, after loading arena.ko:
+ * insmod arena-bench.ko requests=1000000 objs_per_request=128
+ */
+static unsigned int requests = 100000;
+module_param(requests, uint, 0444);
+MODULE_PARM_DESC(requests, "Number of simulated requests");
+
+static unsigned int objs_per_request = 64;
+module_param(objs_per_request, uint, 0444);
+MODULE_PARM_DESC(objs_per_request, "struct test objects per request");
+
+static unsigned int chunk_order = 2;
+module_param(chunk_order, uint, 0444);
+MODULE_PARM_DESC(chunk_order, "Arena chunk size as a page order");
+
+static void arena_bench_report(const char *what, u64 ns)
+{
+	PR_DEBUG("%-8s %u requests x %u objs: " BENCH_FP_FMT " ns/request, "
+		 BENCH_FP_FMT " ns/obj\n", what, requests, objs_per_request,
+		 BENCH_FP_ARG(bench_ns_per_op(ns, requests)),
+		 BENCH_FP_ARG(bench_ns_per_op(ns, (u64)requests *
+					      objs_per_request)));
+}
+
+static int arena_bench_kmalloc(struct test **objs)
+{
+	unsigned int r, i;
+	u64 start;
+
+	start = ktime_get_ns();
+	for (r = 0; r < requests; r++) {
+		for (i = 0; i < objs_per_request; i++) {
+			objs[i] = kmalloc(sizeof(struct test), GFP_KERNEL);
+			if (unlikely(!objs[i]))
+				goto err_free;
+			objs[i]->first = r;
+			objs[i]->second = i;
+		}
+		for (i = 0; i < objs_per_request; i++)
+			kfree(objs[i]);
+		cond_resched();
+	}
+	arena_bench_report("kmalloc", ktime_get_ns() - start);
+	return 0;
+
+err_free:
+	while (i--)
+		kfree(objs[i]);
+	return -ENOMEM;
+}
+
+static int arena_bench_arena(void)
+{
+	struct arena a;
+	struct test *t;
+	unsigned int r, i;
+	u64 start;
+	int err = 0;
+
+	arena_init(&a, chunk_order, GFP_KERNEL);
+
+	start = ktime_get_ns();
+	for (r = 0; r < requests; r++) {
+		for (i = 0; i < objs_per_request; i++) {
+			t = arena_new(&a, struct test);
+			if (unlikely(!t)) {
+				err = -ENOMEM;
+				goto out;
+			}
+			t->first = r;
+			t->second = i;
+		}
+		arena_reset(&a);
+		cond_resched();
+	}
+	arena_bench_report("arena", ktime_get_ns() - start);
+out:
+	arena_destroy(&a);
+	return err;
+}
+
+static int __init arena_bench_init(void)
+{
+	struct test **objs;
+	int err;
+
+	if (!requests || !objs_per_request || chunk_order > MAX_PAGE_ORDER)
+		return -EINVAL;
+
+	objs = kvmalloc_array(objs_per_request, sizeof(*objs), GFP_KERNEL);
+	if (!objs)
+		return -ENOMEM;
+
+	err = arena_bench_kmalloc(objs);
+	if (!err)
+		err = arena_bench_arena();
+	if (err)
+		PR_ERROR("benchmark failed: %d\n", err);
+
+	kvfree(objs);
+	return err;
+}
+
+static void __exit arena_bench_exit(void)
+{
+	PR_DEBUG("module unloaded\n");
+}
+
+module_init(arena_bench_init);
+module_exit(arena_bench_exit);
+
+MODULE_AUTHOR("Bruno E. O. Meneguele <bmeneguele@gmail.com>");
+MODULE_DESCRIPTION("Arena versus kmalloc/kfree for request scoped objects");
+MODULE_LICENSE("GPL");
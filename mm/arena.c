@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2026 Bruno E. O. Meneguele <bmeneguele@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 2 as published by the
+ * Free Software Foundation.
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/gfp.h>
+#include <linux/mm.h>
+#include <linux/overflow.h>
+
+#include "arena.h"
+
+#define ARENA_CHUNK_SIZE(order)	(PAGE_SIZE << (order))
+
+static struct arena_chunk *arena_chunk_alloc(struct arena *a,
+					     unsigned int order)
+{
+	struct arena_chunk *c;
+
+	c = (struct arena_chunk *)__get_free_pages(a->gfp, order);
+	if (c) {
+		c->order = order;
+		c->next = NULL;
+	}
+	return c;
+}
+
+static void arena_chunk_free(struct arena_chunk *c)
+{
+	free_pages((unsigned long)c, c->order);
+}
+
+static void arena_chunk_use(struct arena *a, struct arena_chunk *c)
+{
+	a->ptr = (unsigned long)c->data;
+	a->end = (unsigned long)c + ARENA_CHUNK_SIZE(c->order);
+}
+
+/*
+ * The current chunk is exhausted. Objects that don't fit a regular chunk get
+ * a chunk of their own, linked behind the current one so the space left in it
+ * is still used by the next allocations.
+ */
+void *__arena_alloc_slow(struct arena *a, size_t size, size_t align)
+{
+	struct arena_chunk *c;
+	unsigned int order = a->order;
+	size_t need;
+
+	if (check_add_overflow(sizeof(*c) + align - 1, size, &need))
+		return NULL;
+
+	if (need > ARENA_CHUNK_SIZE(order)) {
+		order = get_order(need);
+		if (order > MAX_PAGE_ORDER)
+			return NULL;
+		c = arena_chunk_alloc(a, order);
+		if (!c)
+			return NULL;
+		if (a->chunks) {
+			c->next = a->chunks->next;
+			a->chunks->next = c;
+		} else {
+			a->chunks = c;
+		}
+		a->used += size;
+		return (void *)ALIGN((unsigned long)c->data, align);
+	}
+
+	c = arena_chunk_alloc(a, order);
+	if (!c)
+		return NULL;
+	c->next = a->chunks;
+	a->chunks = c;
+	arena_chunk_use(a, c);
+	return arena_alloc(a, size, align);
+}
+EXPORT_SYMBOL_GPL(__arena_alloc_slow);
+
+void arena_init(struct arena *a, unsigned int order, gfp_t gfp)
+{
+	a->ptr = 0;
+	a->end = 0;
+	a->chunks = NULL;
+	a->order = order;
+	a->gfp = gfp;
+	a->used = 0;
+}
+EXPORT_SYMBOL_GPL(arena_init);
+
+/*
+ * Free every object at once. One regular chunk is kept, thus an arena reused
+ * for similar batches reaches the page allocator only when a batch outgrows
+ * it.
+ */
+void arena_reset(struct arena *a)
+{
+	struct arena_chunk *c, *next, *keep = NULL;
+
+	for (c = a->chunks; c; c = next) {
+		next = c->next;
+		if (!keep && c->order == a->order) {
+			keep = c;
+			continue;
+		}
+		arena_chunk_free(c);
+	}
+
+	a->chunks = keep;
+	a->used = 0;
+	if (keep) {
+		keep->next = NULL;
+		arena_chunk_use(a, keep);
+	} else {
+		a->ptr = 0;
+		a->end = 0;
+	}
+}
+EXPORT_SYMBOL_GPL(arena_reset);
+
+void arena_destroy(struct arena *a)
+{
+	struct arena_chunk *c, *next;
+
+	for (c = a->chunks; c; c = next) {
+		next = c->next;
+		arena_chunk_free(c);
+	}
+	arena_init(a, a->order, a->gfp);
+}
+EXPORT_SYMBOL_GPL(arena_destroy);
+
+MODULE_AUTHOR("Bruno E. O. Meneguele <bmeneguele@gmail.com>");
+MODULE_DESCRIPTION("Page backed bump allocator");
+MODULE_LICENSE("GPL");
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2026 Bruno E. O. Meneguele <bmeneguele@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 2 as published by the
+ * Free Software Foundation.
+ */
+
+#ifndef __ARENA_H
+#define __ARENA_H
+
+#include <linux/types.h>
+#include <linux/gfp.h>
+#include <linux/align.h>
+#include <linux/compiler.h>
+
+/*
+ * Bump (arena) allocator for objects sharing the same lifetime, i.e. all the
+ * objects created while handling a single request.
+ *
+ * Objects are carved out of page backed chunks by moving a pointer forward,
+ * there is no per-object free: the whole arena is given back at once with
+ * arena_reset(), which keeps the first chunk around for the next batch, or
+ * arena_destroy(). An arena has a single owner, there is no locking at all.
+ */
+
+struct arena_chunk {
+	struct arena_chunk *next;
+	unsigned int order;
+	/* Objects start right after the header */
+	unsigned long data[];
+};
+
+struct arena {
+	/* Bump pointer and end of the current chunk */
+	unsigned long ptr;
+	unsigned long end;
+	/* Most recent chunk first */
+	struct arena_chunk *chunks;
+	unsigned int order;
+	gfp_t gfp;
+	/* Bytes handed out since the last reset, padding included */
+	size_t used;
+};
+
+void arena_init(struct arena *a, unsigned int order, gfp_t gfp);
+void arena_reset(struct arena *a);
+void arena_destroy(struct arena *a);
+void *__arena_alloc_slow(struct arena *a, size_t size, size_t align);
+
+/* 'align' must be a power of two */
+static inline void *arena_alloc(struct arena *a, size_t size, size_t align)
+{
+	unsigned long p = ALIGN(a->ptr, align);
+
+	if (likely(p + size <= a->end && p >= a->ptr)) {
+		a->used += p + size - a->ptr;
+		a->ptr = p + size;
+		return (void *)p;
+	}
+	return __arena_alloc_slow(a, size, align);
+}
+
+#define arena_new(a, type) \
+	((type *)arena_alloc((a), sizeof(type), __alignof__(type)))
+
+#endif /* __ARENA_H */
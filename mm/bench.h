@@ -0,0 +1,277 @@
+/*
+ * Copyright (c) 2026 Bruno E. O. Meneguele <bmeneguele@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 2 as published by the
+ * Free Software Foundation.
+ */
+
+#ifndef __BENCH_H
+#define __BENCH_H
+
+#include <linux/kernel.h>
+#include <linux/kthread.h>
+#include <linux/completion.h>
+#include <linux/cpumask.h>
+#include <linux/atomic.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/err.h>
+#include <linux/random.h>
+#include <linux/perf_event.h>
+
+#include "utils.h"
+
+/*
+ * Helpers shared by the benchmarks in this directory: one kthread bound to
+ * each selected CPU, all of them released at the same time so they really
+ * contend with each other.
+ *
+ * Every benchmark module is built on its own, thus everything in here is kept
+ * static inline instead of linking the same object into several modules.
+ */
+
+/* Values scaled by 100, printed with two decimal places */
+#define BENCH_FP_FMT		"%llu.%02llu"
+#define BENCH_FP_ARG(v)		div_u64((v), 100), \
+				(u64)((v) - div_u64((v), 100) * 100)
+
+/* ns per operation and operations per second, both scaled by 100 */
+static inline u64 bench_ns_per_op(u64 ns, u64 ops)
+{
+	return ops ? div64_u64(ns * 100, ops) : 0;
+}
+
+static inline u64 bench_mops(u64 ns, u64 ops)
+{
+	/* ops/ns * 1000 = Mops/s */
+	return ns ? div64_u64(ops * 100000, ns) : 0;
+}
+
+struct bench_run;
+
+struct bench_thread {
+	struct task_struct *task;
+	struct bench_run *run;
+	unsigned int cpu;
+	/* Filled by the benchmark function */
+	u64 ops;
+	u64 ns;
+	int err;
+	void *priv;
+};
+
+typedef int (*bench_fn_t)(struct bench_thread *bt);
+
+struct bench_run {
+	const char *name;
+	bench_fn_t fn;
+	void *data;
+	struct completion start;
+	struct completion done;
+	atomic_t pending;
+	/* Wall time from the start signal until the last thread finished */
+	u64 wall_ns;
+	unsigned int nr_threads;
+	struct bench_thread threads[];
+};
+
+/*
+ * Allocate a run with one thread per CPU in 'cpus', up to 'max_threads'
+ * (0 means no limit). 'name' must stay valid for the whole run.
+ */
+static inline struct bench_run *bench_run_alloc(const char *name,
+						const struct cpumask *cpus,
+						unsigned int max_threads)
+{
+	struct bench_run *run;
+	unsigned int nr, cpu, i = 0;
+
+	nr = cpumask_weight(cpus);
+	if (max_threads && max_threads < nr)
+		nr = max_threads;
+	if (!nr)
+		return ERR_PTR(-EINVAL);
+
+	run = kzalloc(struct_size(run, threads, nr), GFP_KERNEL);
+	if (!run)
+		return ERR_PTR(-ENOMEM);
+
+	run->name = name;
+	run->nr_threads = nr;
+	for_each_cpu(cpu, cpus) {
+		if (i == nr)
+			break;
+		run->threads[i].run = run;
+		run->threads[i].cpu = cpu;
+		i++;
+	}
+	return run;
+}
+
+static inline void bench_run_free(struct bench_run *run)
+{
+	kfree(run);
+}
+
+static inline int bench_thread_fn(void *arg)
+{
+	struct bench_thread *bt = arg;
+	struct bench_run *run = bt->run;
+
+	wait_for_completion(&run->start);
+	bt->err = run->fn(bt);
+	if (atomic_dec_and_test(&run->pending))
+		complete(&run->done);
+
+	/* Stay around until bench_run_exec() reaps us with kthread_stop(),
+	 * otherwise the task could be gone (and this module code with it)
+	 * before it gets there */
+	for (;;) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (kthread_should_stop())
+			break;
+		schedule();
+	}
+	__set_current_state(TASK_RUNNING);
+	return 0;
+}
+
+/*
+ * Run 'fn' on every thread of 'run' at once and wait for all of them. The
+ * same run can be executed several times, i.e. once per benchmark mode.
+ * Returns the first error reported by a thread.
+ */
+static inline int bench_run_exec(struct bench_run *run, bench_fn_t fn,
+				 void *data)
+{
+	struct bench_thread *bt;
+	unsigned int i;
+	u64 start;
+	int err = 0;
+
+	run->fn = fn;
+	run->data = data;
+	init_completion(&run->start);
+	init_completion(&run->done);
+	atomic_set(&run->pending, run->nr_threads);
+
+	for (i = 0; i < run->nr_threads; i++) {
+		bt = &run->threads[i];
+		bt->ops = 0;
+		bt->ns = 0;
+		bt->err = 0;
+		bt->task = kthread_create_on_node(bench_thread_fn, bt,
+						  cpu_to_node(bt->cpu), "%s/%u",
+						  run->name, bt->cpu);
+		if (IS_ERR(bt->task)) {
+			err = PTR_ERR(bt->task);
+			goto err_stop;
+		}
+		kthread_bind(bt->task, bt->cpu);
+	}
+
+	for (i = 0; i < run->nr_threads; i++)
+		wake_up_process(run->threads[i].task);
+
+	start = ktime_get_ns();
+	complete_all(&run->start);
+	wait_for_completion(&run->done);
+	run->wall_ns = ktime_get_ns() - start;
+
+	for (i = 0; i < run->nr_threads; i++) {
+		bt = &run->threads[i];
+		kthread_stop(bt->task);
+		if (bt->err && !err)
+			err = bt->err;
+	}
+	return err;
+
+err_stop:
+	/* Threads never woken up exit without calling bench_thread_fn() */
+	while (i--)
+		kthread_stop(run->threads[i].task);
+	return err;
+}
+
+/* Sum of the operations made by every thread */
+static inline u64 bench_run_ops(struct bench_run *run)
+{
+	u64 ops = 0;
+	unsigned int i;
+
+	for (i = 0; i < run->nr_threads; i++)
+		ops += run->threads[i].ops;
+	return ops;
+}
+
+/*
+ * Print aggregate throughput and the per-thread ns/op spread, where a wide
+ * min/max gap means some CPUs were starved by the others.
+ */
+static inline void bench_run_report(struct bench_run *run, const char *what)
+{
+	struct bench_thread *bt;
+	u64 v, min = U64_MAX, max = 0, sum = 0;
+	unsigned int i;
+
+	for (i = 0; i < run->nr_threads; i++) {
+		bt = &run->threads[i];
+		v = bench_ns_per_op(bt->ns, bt->ops);
+		min = min(min, v);
+		max = max(max, v);
+		sum += v;
+	}
+
+	PR_DEBUG("%-12s %u threads: " BENCH_FP_FMT " Mops/s, ns/op avg "
+		 BENCH_FP_FMT " min " BENCH_FP_FMT " max " BENCH_FP_FMT "\n",
+		 what, run->nr_threads,
+		 BENCH_FP_ARG(bench_mops(run->wall_ns, bench_run_ops(run))),
+		 BENCH_FP_ARG(div_u64(sum, run->nr_threads)),
+		 BENCH_FP_ARG(min), BENCH_FP_ARG(max));
+}
+
+/*
+ * Shuffle a table of 'n' entries, each holding its own index, into a single
+ * random cycle (Sattolo's algorithm): following the indexes from any entry
+ * visits all of them before coming back, and no prefetcher can guess the next
+ * one. 'swap' exchanges entries i and j of the caller's table.
+ */
+static inline void bench_sattolo(unsigned long n,
+				 void (*swap)(void *data, unsigned long i,
+					      unsigned long j),
+				 void *data)
+{
+	unsigned long i;
+
+	for (i = n - 1; i > 0; i--) {
+		swap(data, i, get_random_u32_below(i));
+		if (!(i & 0xffff))
+			cond_resched();
+	}
+}
+
+/*
+ * dTLB read misses of the calling task. Returns NULL when the PMU doesn't
+ * provide the event, the benchmark then runs uncounted.
+ */
+static inline struct perf_event *bench_perf_dtlb_create(void)
+{
+	struct perf_event_attr attr = {
+		.type = PERF_TYPE_HW_CACHE,
+		.size = sizeof(attr),
+		.config = PERF_COUNT_HW_CACHE_DTLB |
+			  (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+			  (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+		.pinned = 1,
+		.disabled = 1,
+	};
+	struct perf_event *ev;
+
+	ev = perf_event_create_kernel_counter(&attr, -1, current, NULL, NULL);
+	return IS_ERR(ev) ? NULL : ev;
+}
+
+#endif /* __BENCH_H */
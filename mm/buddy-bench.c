@@ -0,0 +1,246 @@
+/*
+ * Copyright (c) 2026 Bruno E. O. Meneguele <bmeneguele@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 2 as published by the
+ * Free Software Foundation.
+ */
+
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/gfp.h>
+#include <linux/mm.h>
+#include <linux/vmalloc.h>
+#include <linux/random.h>
+#include <linux/ktime.h>
+
+#include "utils.h"
+#include "bench.h"
+#include "buddy.h"
+
+/*
+ * For every order from 0 to BUDDY_MAX_ORDER, allocate 'batch' blocks and free
+ * them back, 'bench_iters' times, with the buddy allocator over a reserved
+ * range of vmalloc address space and with alloc_pages(). Then the range is
+ * filled with random small orders, half of the blocks are freed at random and
+ * the fragmentation left behind is reported. The buddy stays in that state
+ * until the module is removed, it's also readable from debugfs
+ * buddy/buddy-bench.
+ *
+ * Example, after loading buddy.ko:
+ * insmod buddy-bench.ko bench_iters=100000 region_mb=512
+ */
+static unsigned int bench_iters = 10000;
+module_param(bench_iters, uint, 0444);
+MODULE_PARM_DESC(bench_iters, "Alloc/free rounds per order");
+
+static unsigned int batch = 16;
+module_param(batch, uint, 0444);
+MODULE_PARM_DESC(batch, "Blocks held before freeing them");
+
+static unsigned int region_mb = 256;
+module_param(region_mb, uint, 0444);
+MODULE_PARM_DESC(region_mb, "Size of the region managed by the buddy");
+
+static unsigned int frag_order = 3;
+module_param(frag_order, uint, 0444);
+MODULE_PARM_DESC(frag_order, "Largest order used to fragment the region");
+
+static struct buddy bench_buddy;
+static struct vm_struct *bench_area;
+
+struct buddy_block {
+	void *addr;
+	unsigned int order;
+};
+
+static int buddy_bench_buddy(unsigned int order, void **blocks, u64 *ns)
+{
+	unsigned int r, i;
+	u64 start;
+
+	start = ktime_get_ns();
+	for (r = 0; r < bench_iters; r++) {
+		for (i = 0; i < batch; i++) {
+			blocks[i] = buddy_alloc(&bench_buddy, order);
+			if (unlikely(!blocks[i]))
+				goto err_free;
+		}
+		for (i = 0; i < batch; i++)
+			buddy_free(&bench_buddy, blocks[i], order);
+		cond_resched();
+	}
+	*ns = ktime_get_ns() - start;
+	return 0;
+
+err_free:
+	while (i--)
+		buddy_free(&bench_buddy, blocks[i], order);
+	return -ENOMEM;
+}
+
+static int buddy_bench_pages(unsigned int order, void **blocks, u64 *ns)
+{
+	struct page **pages = (struct page **)blocks;
+	unsigned int r, i;
+	u64 start;
+
+	start = ktime_get_ns();
+	for (r = 0; r < bench_iters; r++) {
+		for (i = 0; i < batch; i++) {
+			pages[i] = alloc_pages(GFP_KERNEL | __GFP_NOWARN, order);
+			if (unlikely(!pages[i]))
+				goto err_free;
+		}
+		for (i = 0; i < batch; i++)
+			__free_pages(pages[i], order);
+		cond_resched();
+	}
+	*ns = ktime_get_ns() - start;
+	return 0;
+
+err_free:
+	while (i--)
+		__free_pages(pages[i], order);
+	return -ENOMEM;
+}
+
+static int buddy_bench_orders(void)
+{
+	u64 ops = (u64)bench_iters * batch, buddy_ns, pages_ns;
+	unsigned int order;
+	void **blocks;
+	int err = 0;
+
+	blocks = kmalloc_array(batch, sizeof(*blocks), GFP_KERNEL);
+	if (!blocks)
+		return -ENOMEM;
+
+	for (order = 0; order <= BUDDY_MAX_ORDER; order++) {
+		err = buddy_bench_buddy(order, blocks, &buddy_ns);
+		if (err) {
+			PR_ERROR("buddy: order %u allocation failed\n", order);
+			break;
+		}
+		err = buddy_bench_pages(order, blocks, &pages_ns);
+		if (err) {
+			PR_ERROR("alloc_pages: order %u allocation failed\n",
+				 order);
+			break;
+		}
+		PR_DEBUG("order %2u: buddy " BENCH_FP_FMT " ns/op, alloc_pages "
+			 BENCH_FP_FMT " ns/op\n", order,
+			 BENCH_FP_ARG(bench_ns_per_op(buddy_ns, ops)),
+			 BENCH_FP_ARG(bench_ns_per_op(pages_ns, ops)));
+	}
+
+	kfree(blocks);
+	return err;
+}
+
+/*
+ * Fill the region with blocks of random orders up to frag_order, then free a
+ * random half of them: what's left is scattered all over the region, just
+ * like long running workloads leave the page allocator. The other half stays
+ * allocated, buddy_destroy() drops it all at module exit.
+ */
+static int buddy_bench_fragment(void)
+{
+	unsigned long i, nr = 0, max = bench_buddy.nr_pages;
+	struct buddy_block *blocks, tmp;
+	struct buddy_stats stats;
+	unsigned int o, idx;
+
+	blocks = kvmalloc_array(max, sizeof(*blocks), GFP_KERNEL);
+	if (!blocks)
+		return -ENOMEM;
+
+	for (o = frag_order; ; ) {
+		blocks[nr].addr = buddy_alloc(&bench_buddy, o);
+		if (blocks[nr].addr) {
+			blocks[nr++].order = o;
+			o = get_random_u32_inclusive(0, frag_order);
+		} else if (!o--) {
+			/* Not even a single page left */
+			break;
+		}
+	}
+
+	/* Fisher-Yates: free the first half of a shuffled block list */
+	for (i = nr - 1; i > 0; i--) {
+		idx = get_random_u32_below(i + 1);
+		tmp = blocks[i];
+		blocks[i] = blocks[idx];
+		blocks[idx] = tmp;
+	}
+	for (i = 0; i < nr / 2; i++)
+		buddy_free(&bench_buddy, blocks[i].addr, blocks[i].order);
+
+	buddy_get_stats(&bench_buddy, &stats);
+	PR_DEBUG("fragmented: %lu blocks up to order %u, %lu of %lu pages "
+		 "free\n", nr, frag_order, stats.free_pages, stats.nr_pages);
+	for (o = 0; o <= BUDDY_MAX_ORDER; o++) {
+		idx = buddy_unusable_index(&stats, o);
+		PR_DEBUG("order %2u: %lu free blocks, unusable index %u.%03u\n",
+			 o, stats.nr_free[o], idx / 1000, idx % 1000);
+	}
+
+	kvfree(blocks);
+	return 0;
+}
+
+static int __init buddy_bench_init(void)
+{
+	size_t size = (size_t)region_mb << 20;
+	int err;
+
+	if (!bench_iters || !batch || frag_order > BUDDY_MAX_ORDER ||
+	    ((size_t)batch << BUDDY_MAX_ORDER) > size >> PAGE_SHIFT) {
+		PR_ERROR("the region must fit batch blocks of order %u\n",
+			 BUDDY_MAX_ORDER);
+		return -EINVAL;
+	}
+
+	/*
+	 * Stands for the memory of a device, the buddy never touches it: only
+	 * address space is reserved, no page is allocated nor mapped.
+	 */
+	bench_area = get_vm_area(size, VM_MAP);
+	if (!bench_area)
+		return -ENOMEM;
+
+	err = buddy_init(&bench_buddy, "buddy-bench", bench_area->addr, size);
+	if (err)
+		goto err_area;
+
+	PR_DEBUG("%u MiB region, %u rounds of %u blocks per order\n",
+		 region_mb, bench_iters, batch);
+	err = buddy_bench_orders();
+	if (!err)
+		err = buddy_bench_fragment();
+	if (!err)
+		return 0;
+
+	PR_ERROR("benchmark failed: %d\n", err);
+	buddy_destroy(&bench_buddy);
+err_area:
+	free_vm_area(bench_area);
+	return err;
+}
+
+static void __exit buddy_bench_exit(void)
+{
+	buddy_destroy(&bench_buddy);
+	free_vm_area(bench_area);
+	PR_DEBUG("module unloaded\n");
+}
+
+module_init(buddy_bench_init);
+module_exit(buddy_bench_exit);
+
+MODULE_AUTHOR("Bruno E. O. Meneguele <bmeneguele@gmail.com>");
+MODULE_DESCRIPTION("Buddy allocator versus the page allocator");
+MODULE_LICENSE("GPL");
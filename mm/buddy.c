@@ -0,0 +1,239 @@
+/*
+ * Copyright (c) 2026 Bruno E. O. Meneguele <bmeneguele@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 2 as published by the
+ * Free Software Foundation.
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/mm.h>
+#include <linux/bitmap.h>
+#include <linux/bitops.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+
+#include "buddy.h"
+
+static struct dentry *buddy_debugfs;
+
+/* Blocks of 'order' fully inside the region */
+static inline unsigned long buddy_nr_blocks(struct buddy *b,
+					    unsigned int order)
+{
+	return b->nr_pages >> order;
+}
+
+static inline void buddy_set_free(struct buddy *b, unsigned long idx,
+				  unsigned int order)
+{
+	__set_bit(idx, b->free_map[order]);
+	b->nr_free[order]++;
+	if (idx < b->hint[order])
+		b->hint[order] = idx;
+}
+
+static inline void buddy_clear_free(struct buddy *b, unsigned long idx,
+				    unsigned int order)
+{
+	__clear_bit(idx, b->free_map[order]);
+	b->nr_free[order]--;
+}
+
+void *buddy_alloc(struct buddy *b, unsigned int order)
+{
+	unsigned long idx;
+	unsigned int o;
+
+	if (order > BUDDY_MAX_ORDER)
+		return NULL;
+
+	spin_lock(&b->lock);
+	for (o = order; o <= BUDDY_MAX_ORDER; o++)
+		if (b->nr_free[o])
+			break;
+	if (o > BUDDY_MAX_ORDER) {
+		b->failures++;
+		spin_unlock(&b->lock);
+		return NULL;
+	}
+
+	/* Every bit below the hint is clear, the lowest free block is found
+	 * without rescanning the head of the bitmap on every call */
+	idx = find_next_bit(b->free_map[o], buddy_nr_blocks(b, o), b->hint[o]);
+	buddy_clear_free(b, idx, o);
+	b->hint[o] = idx + 1;
+
+	/* Split down to the requested order, the upper halves become free */
+	while (o > order) {
+		o--;
+		idx <<= 1;
+		buddy_set_free(b, idx + 1, o);
+	}
+
+	b->free_pages -= 1UL << order;
+	b->allocs++;
+	spin_unlock(&b->lock);
+
+	return (void *)(b->base + ((idx << order) << PAGE_SHIFT));
+}
+EXPORT_SYMBOL_GPL(buddy_alloc);
+
+/* 'order' must be the one used to allocate 'addr', like free_pages() */
+void buddy_free(struct buddy *b, void *addr, unsigned int order)
+{
+	unsigned long idx, pfn = ((unsigned long)addr - b->base) >> PAGE_SHIFT;
+	unsigned long buddy;
+
+	if (WARN_ON(order > BUDDY_MAX_ORDER || pfn >= b->nr_pages ||
+		    pfn & ((1UL << order) - 1)))
+		return;
+
+	spin_lock(&b->lock);
+	b->free_pages += 1UL << order;
+	idx = pfn >> order;
+	while (order < BUDDY_MAX_ORDER) {
+		buddy = idx ^ 1;
+		if (buddy >= buddy_nr_blocks(b, order) ||
+		    !test_bit(buddy, b->free_map[order]))
+			break;
+		buddy_clear_free(b, buddy, order);
+		idx >>= 1;
+		order++;
+	}
+	buddy_set_free(b, idx, order);
+	spin_unlock(&b->lock);
+}
+EXPORT_SYMBOL_GPL(buddy_free);
+
+void buddy_get_stats(struct buddy *b, struct buddy_stats *stats)
+{
+	spin_lock(&b->lock);
+	stats->nr_pages = b->nr_pages;
+	stats->free_pages = b->free_pages;
+	memcpy(stats->nr_free, b->nr_free, sizeof(stats->nr_free));
+	stats->allocs = b->allocs;
+	stats->failures = b->failures;
+	spin_unlock(&b->lock);
+}
+EXPORT_SYMBOL_GPL(buddy_get_stats);
+
+/*
+ * Unusable free space index, as in the kernel's extfrag debugfs file: the
+ * share of free memory, scaled by 1000, that sits in blocks too small to
+ * serve an allocation of 'order'. 0 is no fragmentation at all, 1000 means
+ * the allocation fails even though there may be plenty of free pages.
+ */
+unsigned int buddy_unusable_index(struct buddy_stats *stats,
+				  unsigned int order)
+{
+	unsigned long usable = 0;
+	unsigned int o;
+
+	if (!stats->free_pages)
+		return 1000;
+
+	for (o = order; o <= BUDDY_MAX_ORDER; o++)
+		usable += stats->nr_free[o] << o;
+	return div_u64((u64)(stats->free_pages - usable) * 1000,
+		       stats->free_pages);
+}
+EXPORT_SYMBOL_GPL(buddy_unusable_index);
+
+static int buddy_stats_show(struct seq_file *m, void *v)
+{
+	struct buddy *b = m->private;
+	struct buddy_stats stats;
+	unsigned int o, idx;
+
+	buddy_get_stats(b, &stats);
+	seq_printf(m, "pages %lu\nfree %lu\nallocs %lu\nfailures %lu\n",
+		   stats.nr_pages, stats.free_pages, stats.allocs,
+		   stats.failures);
+
+	seq_puts(m, "\norder free_blocks unusable_index\n");
+	for (o = 0; o <= BUDDY_MAX_ORDER; o++) {
+		idx = buddy_unusable_index(&stats, o);
+		seq_printf(m, "%5u %11lu %10u.%03u\n", o, stats.nr_free[o],
+			   idx / 1000, idx % 1000);
+	}
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(buddy_stats);
+
+/*
+ * Manage 'size' bytes at 'base', both page aligned. The region is split into
+ * the largest naturally aligned blocks that fit, thus sizes which aren't a
+ * multiple of the top block size are fine, the tail just can't merge.
+ */
+int buddy_init(struct buddy *b, const char *name, void *base, size_t size)
+{
+	unsigned long pfn;
+	unsigned int o;
+
+	if (!PAGE_ALIGNED(base) || !PAGE_ALIGNED(size) || !size)
+		return -EINVAL;
+
+	memset(b, 0, sizeof(*b));
+	b->name = name;
+	b->base = (unsigned long)base;
+	b->nr_pages = size >> PAGE_SHIFT;
+	spin_lock_init(&b->lock);
+
+	for (o = 0; o <= BUDDY_MAX_ORDER; o++) {
+		b->free_map[o] = bitmap_zalloc(buddy_nr_blocks(b, o) ?: 1,
+					       GFP_KERNEL);
+		if (!b->free_map[o])
+			goto err;
+	}
+
+	for (pfn = 0; pfn < b->nr_pages; pfn += 1UL << o) {
+		for (o = BUDDY_MAX_ORDER; o; o--)
+			if (!(pfn & ((1UL << o) - 1)) &&
+			    pfn + (1UL << o) <= b->nr_pages)
+				break;
+		buddy_set_free(b, pfn >> o, o);
+	}
+	b->free_pages = b->nr_pages;
+
+	b->debugfs = debugfs_create_file(name, 0444, buddy_debugfs, b,
+					 &buddy_stats_fops);
+	return 0;
+err:
+	buddy_destroy(b);
+	return -ENOMEM;
+}
+EXPORT_SYMBOL_GPL(buddy_init);
+
+/* The region itself belongs to the caller, only the metadata goes away */
+void buddy_destroy(struct buddy *b)
+{
+	unsigned int o;
+
+	debugfs_remove(b->debugfs);
+	b->debugfs = NULL;
+	for (o = 0; o <= BUDDY_MAX_ORDER; o++) {
+		bitmap_free(b->free_map[o]);
+		b->free_map[o] = NULL;
+	}
+}
+EXPORT_SYMBOL_GPL(buddy_destroy);
+
+static int __init buddy_module_init(void)
+{
+	buddy_debugfs = debugfs_create_dir("buddy", NULL);
+	return 0;
+}
+
+static void __exit buddy_module_exit(void)
+{
+	debugfs_remove_recursive(buddy_debugfs);
+}
+
+module_init(buddy_module_init);
+module_exit(buddy_module_exit);
+
+MODULE_AUTHOR("Bruno E. O. Meneguele <bmeneguele@gmail.com>");
+MODULE_DESCRIPTION("Bitmap based buddy allocator for private memory regions");
+MODULE_LICENSE("GPL");
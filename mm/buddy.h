@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2026 Bruno E. O. Meneguele <bmeneguele@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 2 as published by the
+ * Free Software Foundation.
+ */
+
+#ifndef __BUDDY_H
+#define __BUDDY_H
+
+#include <linux/types.h>
+#include <linux/spinlock.h>
+
+/*
+ * Binary buddy allocator over a caller provided region, i.e. a vmalloc
+ * reservation or the aperture of a device, handing out blocks of 2^order
+ * pages like the page allocator does.
+ *
+ * Free blocks are tracked with one bitmap per order, bit n meaning the n-th
+ * block of that order is free, so finding a free block is a find_next_bit()
+ * away and checking whether a buddy can be merged is a test_bit(). All the
+ * metadata lives outside the region, which is never touched: it may as well
+ * not be CPU accessible.
+ */
+
+/* Largest block is 2^BUDDY_MAX_ORDER pages, as MAX_PAGE_ORDER on x86 */
+#define BUDDY_MAX_ORDER		10
+#define BUDDY_NR_ORDERS		(BUDDY_MAX_ORDER + 1)
+
+struct dentry;
+
+struct buddy_stats {
+	unsigned long nr_pages;
+	unsigned long free_pages;
+	unsigned long nr_free[BUDDY_NR_ORDERS];
+	unsigned long allocs;
+	unsigned long failures;
+};
+
+struct buddy {
+	const char *name;
+	unsigned long base;
+	unsigned long nr_pages;
+	spinlock_t lock;
+
+	unsigned long *free_map[BUDDY_NR_ORDERS];
+	unsigned long nr_free[BUDDY_NR_ORDERS];
+	/* No free block of the order below this index */
+	unsigned long hint[BUDDY_NR_ORDERS];
+	unsigned long free_pages;
+
+	unsigned long allocs;
+	unsigned long failures;
+	struct dentry *debugfs;
+};
+
+int buddy_init(struct buddy *b, const char *name, void *base, size_t size);
+void buddy_destroy(struct buddy *b);
+
+void *buddy_alloc(struct buddy *b, unsigned int order);
+void buddy_free(struct buddy *b, void *addr, unsigned int order);
+
+void buddy_get_stats(struct buddy *b, struct buddy_stats *stats);
+unsigned int buddy_unusable_index(struct buddy_stats *stats,
+				  unsigned int order);
+
+#endif /* __BUDDY_H */
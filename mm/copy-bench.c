@@ -0,0 +1,356 @@
+/*
+ * Copyright (c) 2026 Bruno E. O. Meneguele <bmeneguele@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 2 as published by the
+ * Free Software Foundation.
+ */
+
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/mm.h>
+#include <linux/mman.h>
+#include <linux/string.h>
+#include <linux/random.h>
+#include <linux/uaccess.h>
+#include <linux/ktime.h>
+
+#ifdef CONFIG_X86_64
+#include <asm/cpufeature.h>
+#include <asm/fpu/api.h>
+#endif
+
+#include "utils.h"
+#include "bench.h"
+
+/*
+ * Bandwidth of the ways the kernel can move bytes around:
+ * - memcpy and memset, whatever the arch picked (on x86_64 alternatives
+ *   patch in rep movsb/stosb when the CPU has ERMS/FSRM)
+ * - copy_to_user and copy_from_user, against an anonymous mapping made in
+ *   the insmod process, with the STAC/CLAC and fault handling they carry
+ * - rep movsb in inline assembly, without the arch heuristics around it
+ * - AVX2 loads and stores, 128 bytes per iteration, between
+ *   kernel_fpu_begin() and kernel_fpu_end()
+ *
+ * Sizes go from 64 bytes up to 'max_mb' MiB in steps of 4x, first with both
+ * buffers cacheline aligned and then with the source 'misalign' and the
+ * destination 2 * 'misalign' bytes past it. Every size moves about 'bench_mb'
+ * MiB in total, results are in GB/s (10^9 bytes) of data copied or set.
+ * Small sizes stay in the caches, they measure the fixed cost per call;
+ * large ones measure DRAM.
+ *
+ * Example:
+ * insmod copy-bench.ko max_mb=64 bench_mb=4096 misalign=8
+ */
+static unsigned int max_mb = 256;
+module_param(max_mb, uint, 0444);
+MODULE_PARM_DESC(max_mb, "Largest size in MiB");
+
+static unsigned int bench_mb = 1024;
+module_param(bench_mb, uint, 0444);
+MODULE_PARM_DESC(bench_mb, "MiB moved per strategy and size");
+
+static unsigned int misalign = 1;
+module_param(misalign, uint, 0444);
+MODULE_PARM_DESC(misalign, "Source offset in the misaligned runs, in bytes");
+
+#define COPY_MIN_SIZE		64UL
+/* Room for the misaligned runs past the largest size */
+#define COPY_SLACK		(2 * PAGE_SIZE)
+/* kernel_fpu_begin() disables preemption, give the CPU back this often */
+#define COPY_FPU_CHUNK		(64UL << 10)
+
+typedef int (*copy_fn_t)(void *dst, const void *src, size_t len);
+
+struct copy_strategy {
+	const char *name;
+	copy_fn_t fn;
+	/* Which side is the user mapping */
+	bool user_dst;
+	bool user_src;
+	bool avx2;
+};
+
+static int copy_memcpy(void *dst, const void *src, size_t len)
+{
+	memcpy(dst, src, len);
+	return 0;
+}
+
+static int copy_memset(void *dst, const void *src, size_t len)
+{
+	memset(dst, 0x5a, len);
+	return 0;
+}
+
+static int copy_to_user_fn(void *dst, const void *src, size_t len)
+{
+	return copy_to_user((void __user __force *)dst, src, len) ? -EFAULT : 0;
+}
+
+static int copy_from_user_fn(void *dst, const void *src, size_t len)
+{
+	return copy_from_user(dst, (const void __user __force *)src, len) ?
+	       -EFAULT : 0;
+}
+
+#ifdef CONFIG_X86_64
+static int copy_movsb(void *dst, const void *src, size_t len)
+{
+	asm volatile("rep movsb"
+		     : "+D" (dst), "+S" (src), "+c" (len)
+		     : : "memory");
+	return 0;
+}
+
+static int copy_avx2(void *dst, const void *src, size_t len)
+{
+	size_t chunk, tail = len & 127;
+	u8 *d = dst;
+	const u8 *s = src;
+
+	len -= tail;
+	while (len) {
+		chunk = min(len, COPY_FPU_CHUNK);
+		len -= chunk;
+		kernel_fpu_begin();
+		for (; chunk; chunk -= 128, d += 128, s += 128)
+			asm volatile("vmovdqu 0(%1),%%ymm0\n\t"
+				     "vmovdqu 32(%1),%%ymm1\n\t"
+				     "vmovdqu 64(%1),%%ymm2\n\t"
+				     "vmovdqu 96(%1),%%ymm3\n\t"
+				     "vmovdqu %%ymm0,0(%0)\n\t"
+				     "vmovdqu %%ymm1,32(%0)\n\t"
+				     "vmovdqu %%ymm2,64(%0)\n\t"
+				     "vmovdqu %%ymm3,96(%0)"
+				     : : "r" (d), "r" (s) : "memory");
+		kernel_fpu_end();
+	}
+	memcpy(d, s, tail);
+	return 0;
+}
+
+static bool copy_has_avx2(void)
+{
+	return boot_cpu_has(X86_FEATURE_AVX) &&
+	       boot_cpu_has(X86_FEATURE_AVX2) &&
+	       cpu_has_xfeatures(XFEATURE_MASK_SSE | XFEATURE_MASK_YMM, NULL);
+}
+#else
+static bool copy_has_avx2(void)
+{
+	return false;
+}
+#endif /* CONFIG_X86_64 */
+
+static const struct copy_strategy copy_strategies[] = {
+	{ "memcpy", copy_memcpy },
+	{ "memset", copy_memset },
+#ifdef CONFIG_X86_64
+	{ "movsb", copy_movsb },
+	{ "avx2", copy_avx2, .avx2 = true },
+#endif
+	{ "to_user", copy_to_user_fn, .user_dst = true },
+	{ "from_user", copy_from_user_fn, .user_src = true },
+};
+
+struct copy_bufs {
+	u8 *src;
+	u8 *dst;
+	/* Anonymous mapping of the insmod process, used as either side */
+	unsigned long user;
+};
+
+/* GB/s scaled by 100, bytes per ns is GB/s */
+static int copy_measure(const struct copy_strategy *c, void *dst,
+			const void *src, size_t size, u64 *gbps)
+{
+	unsigned long i, iters;
+	u64 start, ns;
+	int err;
+
+	iters = max_t(unsigned long, ((u64)bench_mb << 20) / size, 1);
+
+	/* Warm up: caches, TLB and the user pages faulted in */
+	err = c->fn(dst, src, size);
+	if (err)
+		return err;
+
+	start = ktime_get_ns();
+	for (i = 0; i < iters; i++) {
+		c->fn(dst, src, size);
+		if (!(i & 1023))
+			cond_resched();
+	}
+	ns = ktime_get_ns() - start;
+
+	*gbps = ns ? div64_u64((u64)size * iters * 100, ns) : 0;
+	return 0;
+}
+
+/* A copy of a few odd sizes must match the source byte for byte */
+static int copy_check(const struct copy_strategy *c, struct copy_bufs *b)
+{
+	static const size_t sizes[] = {
+		1, 63, 129, 4097, 3 * COPY_FPU_CHUNK + 5,
+	};
+	unsigned int i;
+	size_t len;
+	int err = 0;
+
+	/* memset has nothing to compare with */
+	if (c->fn == copy_memset)
+		return 0;
+
+	for (i = 0; i < ARRAY_SIZE(sizes); i++) {
+		len = sizes[i];
+		get_random_bytes(b->src, len + 1);
+		memset(b->dst, 0, len + 1);
+
+		if (c->user_src) {
+			err = copy_to_user((void __user *)b->user + 1,
+					   b->src + 1, len) ? -EFAULT : 0;
+			if (!err)
+				err = c->fn(b->dst + 1,
+					    (void __force *)b->user + 1, len);
+		} else if (c->user_dst) {
+			err = c->fn((void __force *)b->user + 1, b->src + 1,
+				    len);
+			if (!err)
+				err = copy_from_user(b->dst + 1,
+						     (void __user *)b->user + 1,
+						     len) ? -EFAULT : 0;
+		} else {
+			err = c->fn(b->dst + 1, b->src + 1, len);
+		}
+		if (err)
+			break;
+
+		/* Not a byte more, not a byte less */
+		if (memcmp(b->dst + 1, b->src + 1, len) || b->dst[0] ||
+		    b->dst[len + 1]) {
+			PR_ERROR("%s: bad copy of %zu bytes\n", c->name, len);
+			err = -EIO;
+			break;
+		}
+	}
+	return err;
+}
+
+static int copy_sweep(struct copy_bufs *b, size_t max, unsigned int off)
+{
+	const struct copy_strategy *c;
+	const void *src;
+	char line[160];
+	unsigned int i;
+	int len, err;
+	size_t size;
+	void *dst;
+	u64 gbps;
+
+	len = scnprintf(line, sizeof(line), "%10s", "bytes");
+	for (i = 0; i < ARRAY_SIZE(copy_strategies); i++)
+		len += scnprintf(line + len, sizeof(line) - len, " %10s",
+				 copy_strategies[i].name);
+	PR_DEBUG("%saligned, GB/s\n", off ? "mis" : "");
+	PR_DEBUG("%s\n", line);
+
+	for (size = COPY_MIN_SIZE; size <= max; size *= 4) {
+		len = scnprintf(line, sizeof(line), "%10zu", size);
+		for (i = 0; i < ARRAY_SIZE(copy_strategies); i++) {
+			c = &copy_strategies[i];
+			if (c->avx2 && !copy_has_avx2()) {
+				len += scnprintf(line + len, sizeof(line) - len,
+						 " %10s", "n/a");
+				continue;
+			}
+
+			src = c->user_src ? (void __force *)b->user : b->src;
+			dst = c->user_dst ? (void __force *)b->user : b->dst;
+			err = copy_measure(c, dst + 2 * off, src + off, size,
+					   &gbps);
+			if (err) {
+				PR_ERROR("%s of %zu bytes failed: %d\n",
+					 c->name, size, err);
+				return err;
+			}
+			len += scnprintf(line + len, sizeof(line) - len,
+					 " %7llu.%02llu", BENCH_FP_ARG(gbps));
+		}
+		PR_DEBUG("%s\n", line);
+	}
+	return 0;
+}
+
+static int __init copy_bench_init(void)
+{
+	size_t max = (size_t)max_mb << 20;
+	struct copy_bufs b = { };
+	unsigned int i;
+	int err;
+
+	if (!max_mb || !bench_mb || max < COPY_MIN_SIZE ||
+	    2 * misalign >= COPY_SLACK)
+		return -EINVAL;
+
+	b.src = vmalloc(max + COPY_SLACK);
+	b.dst = vmalloc(max + COPY_SLACK);
+	if (!b.src || !b.dst) {
+		err = -ENOMEM;
+		goto out;
+	}
+	/* Lives in the insmod process, gone with it at worst */
+	b.user = vm_mmap(NULL, 0, max + COPY_SLACK, PROT_READ | PROT_WRITE,
+			 MAP_ANONYMOUS | MAP_PRIVATE, 0);
+	if (IS_ERR_VALUE(b.user)) {
+		err = (int)b.user;
+		b.user = 0;
+		goto out;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(copy_strategies); i++) {
+		if (copy_strategies[i].avx2 && !copy_has_avx2())
+			continue;
+		err = copy_check(&copy_strategies[i], &b);
+		if (err)
+			goto out;
+	}
+	memset(b.src, 0xa5, max + COPY_SLACK);
+
+#ifdef CONFIG_X86_64
+	PR_DEBUG("%u MiB max, %u MiB per size, misalign %u, erms %d fsrm %d "
+		 "avx2 %d\n", max_mb, bench_mb, misalign,
+		 boot_cpu_has(X86_FEATURE_ERMS),
+		 boot_cpu_has(X86_FEATURE_FSRM), copy_has_avx2());
+#else
+	PR_DEBUG("%u MiB max, %u MiB per size, misalign %u\n", max_mb,
+		 bench_mb, misalign);
+#endif
+	err = copy_sweep(&b, max, 0);
+	if (!err && misalign)
+		err = copy_sweep(&b, max, misalign);
+
+out:
+	if (b.user)
+		vm_munmap(b.user, max + COPY_SLACK);
+	vfree(b.dst);
+	vfree(b.src);
+	return err;
+}
+
+static void __exit copy_bench_exit(void)
+{
+	PR_DEBUG("module unloaded\n");
+}
+
+module_init(copy_bench_init);
+module_exit(copy_bench_exit);
+
+MODULE_AUTHOR("Bruno E. O. Meneguele <bmeneguele@gmail.com>");
+MODULE_DESCRIPTION("memcpy, memset, user copies, rep movsb and AVX2 bandwidth");
+MODULE_LICENSE("GPL");
@@ -0,0 +1,225 @@
+/*
+ * Copyright (c) 2026 Bruno E. O. Meneguele <bmeneguele@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 2 as published by the
+ * Free Software Foundation.
+ */
+
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/cpumask.h>
+#include <linux/ktime.h>
+
+#include "utils.h"
+#include "bench.h"
+#include "guard-cache.h"
+
+/*
+ * Throughput cost of a guard_cache over its backing kmem_cache. Every online
+ * CPU allocates 'batch' objects, touches them and frees them, first straight
+ * from the cache and then through the guard cache at each sample rate of
+ * 'rates' (0 keeps sampling off, only the wrappers are paid). The overhead is
+ * relative to the plain cache.
+ *
+ * With 'selftest' set, a guarded object gets a byte written right in front of
+ * it and the free must report it, expect a splat in the log. Example, after
+ * loading guard-cache.ko:
+ * insmod guard-cache-bench.ko bench_iters=10000000 rates=0,10000,1000,100
+ */
+static unsigned int bench_iters = 1000000;
+module_param(bench_iters, uint, 0444);
+MODULE_PARM_DESC(bench_iters, "Allocations made by each CPU per rate");
+
+static unsigned int obj_size = 128;
+module_param(obj_size, uint, 0444);
+MODULE_PARM_DESC(obj_size, "Object size in bytes");
+
+static unsigned int batch = 16;
+module_param(batch, uint, 0444);
+MODULE_PARM_DESC(batch, "Objects held by a CPU before freeing them");
+
+static unsigned int nr_slots = 255;
+module_param(nr_slots, uint, 0444);
+MODULE_PARM_DESC(nr_slots, "Guarded slots in the pool");
+
+static unsigned int rates[8] = { 0, 100000, 10000, 1000, 100 };
+static unsigned int nr_rates = 5;
+module_param_array(rates, uint, &nr_rates, 0444);
+MODULE_PARM_DESC(rates, "Sample rates, one in N allocations is guarded");
+
+static bool selftest;
+module_param(selftest, bool, 0444);
+MODULE_PARM_DESC(selftest, "Check that an out of bounds write is caught");
+
+#define GUARD_BENCH_MAX_BATCH	4096
+
+static struct kmem_cache *bench_cache;
+static struct guard_cache bench_gc;
+
+static int guard_bench_thread(struct bench_thread *bt)
+{
+	struct guard_cache *gc = bt->run->data;
+	unsigned int i, j, n;
+	void **objs;
+	u64 start;
+	int err = 0;
+
+	objs = kmalloc_array(batch, sizeof(*objs), GFP_KERNEL);
+	if (!objs)
+		return -ENOMEM;
+
+	start = ktime_get_ns();
+	for (i = 0; i < bench_iters; i += n) {
+		/* The last round may be short */
+		n = min(batch, bench_iters - i);
+		for (j = 0; j < n; j++) {
+			if (gc)
+				objs[j] = guard_cache_alloc(gc, GFP_KERNEL);
+			else
+				objs[j] = kmem_cache_alloc(bench_cache,
+							   GFP_KERNEL);
+			if (unlikely(!objs[j])) {
+				err = -ENOMEM;
+				break;
+			}
+			*(unsigned long *)objs[j] = i + j;
+		}
+		while (j--) {
+			if (gc)
+				guard_cache_free(gc, objs[j]);
+			else
+				kmem_cache_free(bench_cache, objs[j]);
+		}
+		if (unlikely(err))
+			break;
+		bt->ops += n;
+		cond_resched();
+	}
+	bt->ns = ktime_get_ns() - start;
+
+	kfree(objs);
+	return err;
+}
+
+/* An underflow lands on the canary, the free has to count an error */
+static int guard_bench_selftest(void)
+{
+	struct guard_cache_stats before, after;
+	u8 *obj;
+
+	guard_cache_set_sample_rate(&bench_gc, 1);
+	guard_cache_get_stats(&bench_gc, &before);
+	obj = guard_cache_alloc(&bench_gc, GFP_KERNEL);
+	if (!obj)
+		return -ENOMEM;
+	if (!guard_cache_owns(&bench_gc, obj)) {
+		PR_ERROR("selftest: object not guarded, all slots in use?\n");
+		guard_cache_free(&bench_gc, obj);
+		return -EBUSY;
+	}
+
+	PR_DEBUG("selftest: writing before %px, a report follows\n", obj);
+	obj[-1] = 0;
+	guard_cache_free(&bench_gc, obj);
+	guard_cache_get_stats(&bench_gc, &after);
+
+	if (after.errors == before.errors) {
+		PR_ERROR("selftest: out of bounds write not caught\n");
+		return -EIO;
+	}
+	PR_DEBUG("selftest: out of bounds write caught\n");
+	return 0;
+}
+
+static int __init guard_bench_init(void)
+{
+	struct guard_cache_stats stats;
+	struct bench_run *run;
+	u64 base, mops;
+	unsigned int i;
+	char what[16];
+	int err;
+
+	if (!batch || batch > GUARD_BENCH_MAX_BATCH ||
+	    obj_size < sizeof(unsigned long) || !nr_slots) {
+		PR_ERROR("invalid batch (1-%u), object size or slots\n",
+			 GUARD_BENCH_MAX_BATCH);
+		return -EINVAL;
+	}
+
+	bench_cache = kmem_cache_create("guard_bench", obj_size, 0,
+					SLAB_NO_MERGE, NULL);
+	if (!bench_cache)
+		return -ENOMEM;
+
+	err = guard_cache_init(&bench_gc, "guard-bench", bench_cache, 0, 0,
+			       nr_slots);
+	if (err)
+		goto err_cache;
+
+	run = bench_run_alloc("guard-bench", cpu_online_mask, 0);
+	if (IS_ERR(run)) {
+		err = PTR_ERR(run);
+		goto err_gc;
+	}
+
+	PR_DEBUG("%u iterations, %u bytes objects, batch %u, %u slots\n",
+		 bench_iters, obj_size, batch, nr_slots);
+	err = bench_run_exec(run, guard_bench_thread, NULL);
+	if (err)
+		goto err_run;
+	bench_run_report(run, "kmem_cache");
+	base = bench_mops(run->wall_ns, bench_run_ops(run));
+
+	for (i = 0; i < nr_rates; i++) {
+		guard_cache_set_sample_rate(&bench_gc, rates[i]);
+		err = bench_run_exec(run, guard_bench_thread, &bench_gc);
+		if (err)
+			goto err_run;
+
+		snprintf(what, sizeof(what), "1/%u", rates[i]);
+		bench_run_report(run, rates[i] ? what : "sampling off");
+		mops = bench_mops(run->wall_ns, bench_run_ops(run));
+		if (base && mops <= base)
+			PR_DEBUG("overhead +" BENCH_FP_FMT "%%\n",
+				 BENCH_FP_ARG(div64_u64((base - mops) * 10000,
+							base)));
+		else if (base)
+			PR_DEBUG("overhead -" BENCH_FP_FMT "%%\n",
+				 BENCH_FP_ARG(div64_u64((mops - base) * 10000,
+							base)));
+	}
+
+	guard_cache_get_stats(&bench_gc, &stats);
+	PR_DEBUG("guard_cache: %lu sampled, %lu with all slots in use, "
+		 "%lu errors\n", stats.sampled, stats.exhausted, stats.errors);
+
+	if (selftest)
+		err = guard_bench_selftest();
+
+err_run:
+	if (err)
+		PR_ERROR("benchmark failed: %d\n", err);
+	bench_run_free(run);
+err_gc:
+	guard_cache_destroy(&bench_gc);
+err_cache:
+	kmem_cache_destroy(bench_cache);
+	return err;
+}
+
+static void __exit guard_bench_exit(void)
+{
+	PR_DEBUG("module unloaded\n");
+}
+
+module_init(guard_bench_init);
+module_exit(guard_bench_exit);
+
+MODULE_AUTHOR("Bruno E. O. Meneguele <bmeneguele@gmail.com>");
+MODULE_DESCRIPTION("Sampling guarded allocator overhead at several rates");
+MODULE_LICENSE("GPL");
@@ -0,0 +1,359 @@
+/*
+ * Copyright (c) 2026 Bruno E. O. Meneguele <bmeneguele@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 2 as published by the
+ * Free Software Foundation.
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/gfp.h>
+#include <linux/mm.h>
+#include <linux/vmalloc.h>
+#include <linux/percpu.h>
+#include <linux/string.h>
+#include <linux/stacktrace.h>
+#include <linux/log2.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+
+#include "utils.h"
+#include "guard-cache.h"
+
+/* Only x86 has a local, IPI free, flush usable from here */
+#ifndef CONFIG_X86
+#error "guard-cache is x86 only, see guard-cache.h"
+#endif
+
+/* Fills the slot page around the object */
+#define GUARD_CACHE_CANARY	0xaa
+
+static struct dentry *guard_cache_debugfs;
+
+static void *guard_slot_page(struct guard_cache *gc, unsigned int idx)
+{
+	return gc->pool + ((2UL * idx + 1) << PAGE_SHIFT);
+}
+
+static int guard_cache_set_pte(pte_t *pte, unsigned long addr, void *data)
+{
+	struct page *page = data;
+
+	if (page)
+		set_pte_at(&init_mm, addr, pte, mk_pte(page, PAGE_KERNEL));
+	else
+		pte_clear(&init_mm, addr, pte);
+	return 0;
+}
+
+/*
+ * Map 'page' at 'addr' in the pool, or unmap whatever is there with a NULL
+ * page. The page tables of the vmap() area are all there already, nothing is
+ * allocated and this is fine in atomic context.
+ */
+static void guard_cache_map(void *addr, struct page *page)
+{
+	apply_to_page_range(&init_mm, (unsigned long)addr, PAGE_SIZE,
+			    guard_cache_set_pte, page);
+	if (page)
+		return;
+
+	/* Local CPU only, no IPIs from here, see guard-cache.h */
+	asm volatile("invlpg (%0)" : : "r" (addr) : "memory");
+}
+
+void guard_cache_set_sample_rate(struct guard_cache *gc,
+				 unsigned int sample_rate)
+{
+	int cpu;
+
+	/* Objects larger than a slot are never sampled */
+	if (gc->size > PAGE_SIZE)
+		sample_rate = 0;
+
+	WRITE_ONCE(gc->sample_rate, 0);
+	for_each_possible_cpu(cpu)
+		*per_cpu_ptr(gc->countdown, cpu) = sample_rate;
+	WRITE_ONCE(gc->sample_rate, sample_rate);
+}
+EXPORT_SYMBOL_GPL(guard_cache_set_sample_rate);
+
+static void guard_cache_report(struct guard_cache *gc, struct guard_slot *slot,
+			       const void *obj, const char *what)
+{
+	atomic_long_inc(&gc->errors);
+	PR_ERROR("%s: %s at %px\n", gc->name, what, obj);
+	if (slot) {
+		PR_ERROR("%s: slot object %px, allocated by:\n", gc->name,
+			 slot->obj);
+		stack_trace_print(slot->alloc_stack, slot->nr_alloc_stack, 1);
+		if (slot->nr_free_stack) {
+			PR_ERROR("%s: freed by:\n", gc->name);
+			stack_trace_print(slot->free_stack,
+					  slot->nr_free_stack, 1);
+		}
+	}
+	dump_stack();
+}
+
+void *__guard_cache_alloc_slow(struct guard_cache *gc, gfp_t gfp)
+{
+	struct guard_slot *slot;
+	unsigned long flags;
+	unsigned int idx;
+	void *page;
+
+	this_cpu_write(*gc->countdown, READ_ONCE(gc->sample_rate));
+
+	raw_spin_lock_irqsave(&gc->lock, flags);
+	slot = list_first_entry_or_null(&gc->free, struct guard_slot, list);
+	if (slot) {
+		list_del(&slot->list);
+		slot->state = GUARD_SLOT_ALLOCATED;
+		gc->nr_allocated++;
+	}
+	raw_spin_unlock_irqrestore(&gc->lock, flags);
+
+	if (!slot) {
+		atomic_long_inc(&gc->exhausted);
+		return kmem_cache_alloc(gc->cache, gfp);
+	}
+
+	idx = slot - gc->slots;
+	page = guard_slot_page(gc, idx);
+	guard_cache_map(page, gc->pages[idx]);
+	memset(page, GUARD_CACHE_CANARY, PAGE_SIZE);
+
+	slot->obj = page + gc->offset;
+	if (want_init_on_alloc(gfp))
+		memset(slot->obj, 0, gc->size);
+	slot->nr_alloc_stack = stack_trace_save(slot->alloc_stack,
+						GUARD_CACHE_STACK_DEPTH, 1);
+	slot->nr_free_stack = 0;
+	atomic_long_inc(&gc->sampled);
+	return slot->obj;
+}
+EXPORT_SYMBOL_GPL(__guard_cache_alloc_slow);
+
+void __guard_cache_free_slow(struct guard_cache *gc, void *obj)
+{
+	unsigned long pgoff = (obj - gc->pool) >> PAGE_SHIFT;
+	void *page = gc->pool + (pgoff << PAGE_SHIFT);
+	struct guard_slot *slot;
+	unsigned long flags;
+	bool valid;
+
+	/* Even pages are guards, nothing is ever allocated there */
+	if (!(pgoff & 1)) {
+		guard_cache_report(gc, NULL, obj, "invalid free");
+		return;
+	}
+	slot = &gc->slots[pgoff / 2];
+
+	/* Claimed under the lock, racing double frees report only once */
+	raw_spin_lock_irqsave(&gc->lock, flags);
+	valid = slot->state == GUARD_SLOT_ALLOCATED && slot->obj == obj;
+	if (valid)
+		slot->state = GUARD_SLOT_FREE;
+	raw_spin_unlock_irqrestore(&gc->lock, flags);
+
+	if (!valid) {
+		guard_cache_report(gc, slot, obj, slot->state ==
+				   GUARD_SLOT_FREE ? "double free" :
+				   "invalid free");
+		return;
+	}
+
+	/* Whatever isn't the object must still be canary */
+	if (memchr_inv(page, GUARD_CACHE_CANARY, gc->offset) ||
+	    memchr_inv(obj + gc->size, GUARD_CACHE_CANARY,
+		       PAGE_SIZE - gc->offset - gc->size))
+		guard_cache_report(gc, slot, obj, "out of bounds write");
+
+	slot->nr_free_stack = stack_trace_save(slot->free_stack,
+					       GUARD_CACHE_STACK_DEPTH, 1);
+	guard_cache_map(page, NULL);
+
+	/* To the tail: the longer it stays unmapped, the more UAFs fault */
+	raw_spin_lock_irqsave(&gc->lock, flags);
+	list_add_tail(&slot->list, &gc->free);
+	gc->nr_allocated--;
+	raw_spin_unlock_irqrestore(&gc->lock, flags);
+}
+EXPORT_SYMBOL_GPL(__guard_cache_free_slow);
+
+void guard_cache_get_stats(struct guard_cache *gc,
+			   struct guard_cache_stats *stats)
+{
+	stats->sampled = atomic_long_read(&gc->sampled);
+	stats->exhausted = atomic_long_read(&gc->exhausted);
+	stats->errors = atomic_long_read(&gc->errors);
+	stats->nr_allocated = READ_ONCE(gc->nr_allocated);
+}
+EXPORT_SYMBOL_GPL(guard_cache_get_stats);
+
+/*
+ * Counters, then one line per slot ever used, with the stacks below it. Read
+ * racily, it's meant to be looked at after an oops in the pool.
+ */
+static int guard_cache_stats_show(struct seq_file *m, void *v)
+{
+	struct guard_cache *gc = m->private;
+	struct guard_cache_stats stats;
+	struct guard_slot *slot;
+	unsigned int i, j;
+
+	guard_cache_get_stats(gc, &stats);
+	seq_printf(m, "sample_rate %u\nsampled %lu\nexhausted %lu\n"
+		   "errors %lu\nallocated %u\nslots %u\npool %px-%px\n",
+		   READ_ONCE(gc->sample_rate), stats.sampled, stats.exhausted,
+		   stats.errors, stats.nr_allocated, gc->nr_slots, gc->pool,
+		   gc->pool + ((2UL * gc->nr_slots + 1) << PAGE_SHIFT));
+
+	for (i = 0; i < gc->nr_slots; i++) {
+		slot = &gc->slots[i];
+		if (!slot->nr_alloc_stack)
+			continue;
+		seq_printf(m, "slot %u %px-%px object %px %s\n", i,
+			   guard_slot_page(gc, i),
+			   guard_slot_page(gc, i) + PAGE_SIZE, slot->obj,
+			   slot->state == GUARD_SLOT_FREE ? "freed" :
+			   "allocated");
+		for (j = 0; j < slot->nr_alloc_stack; j++)
+			seq_printf(m, "  alloc %pS\n",
+				   (void *)slot->alloc_stack[j]);
+		for (j = 0; j < slot->nr_free_stack; j++)
+			seq_printf(m, "  free  %pS\n",
+				   (void *)slot->free_stack[j]);
+	}
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(guard_cache_stats);
+
+/*
+ * Sample one in 'sample_rate' allocations from 'cache' (0 disables it) into
+ * 'nr_slots' guarded slots. 'align' is the alignment the cache was created
+ * with, guarded objects are aligned the same way.
+ */
+int guard_cache_init(struct guard_cache *gc, const char *name,
+		     struct kmem_cache *cache, unsigned int align,
+		     unsigned int sample_rate, unsigned int nr_slots)
+{
+	unsigned int i, nr_pages = 2 * nr_slots + 1;
+	struct page **map = NULL;
+
+	align = max_t(unsigned int, align, ARCH_SLAB_MINALIGN);
+	if (!nr_slots || !is_power_of_2(align))
+		return -EINVAL;
+
+	memset(gc, 0, sizeof(*gc));
+	gc->name = name;
+	gc->cache = cache;
+	gc->size = kmem_cache_size(cache);
+	if (gc->size <= PAGE_SIZE)
+		gc->offset = PAGE_SIZE - round_up(gc->size, align);
+	gc->nr_slots = nr_slots;
+	raw_spin_lock_init(&gc->lock);
+	INIT_LIST_HEAD(&gc->free);
+	atomic_long_set(&gc->sampled, 0);
+	atomic_long_set(&gc->exhausted, 0);
+	atomic_long_set(&gc->errors, 0);
+
+	gc->countdown = alloc_percpu(unsigned int);
+	gc->slots = kvcalloc(nr_slots, sizeof(*gc->slots), GFP_KERNEL);
+	gc->pages = kvcalloc(nr_slots, sizeof(*gc->pages), GFP_KERNEL);
+	gc->guard = alloc_page(GFP_KERNEL);
+	map = kvmalloc_array(nr_pages, sizeof(*map), GFP_KERNEL);
+	if (!gc->countdown || !gc->slots || !gc->pages || !gc->guard || !map)
+		goto err;
+
+	for (i = 0; i < nr_slots; i++) {
+		gc->pages[i] = alloc_page(GFP_KERNEL);
+		if (!gc->pages[i])
+			goto err;
+	}
+	for (i = 0; i < nr_pages; i++)
+		map[i] = i & 1 ? gc->pages[i / 2] : gc->guard;
+
+	gc->pool = vmap(map, nr_pages, VM_MAP, PAGE_KERNEL);
+	if (!gc->pool)
+		goto err;
+	kvfree(map);
+	map = NULL;
+
+	/* Nothing is accessible until allocated */
+	for (i = 0; i < nr_pages; i++)
+		guard_cache_map(gc->pool + ((unsigned long)i << PAGE_SHIFT),
+				NULL);
+	for (i = 0; i < nr_slots; i++) {
+		gc->slots[i].state = GUARD_SLOT_FREE;
+		list_add_tail(&gc->slots[i].list, &gc->free);
+	}
+
+	guard_cache_set_sample_rate(gc, sample_rate);
+	gc->debugfs = debugfs_create_file(name, 0444, guard_cache_debugfs, gc,
+					  &guard_cache_stats_fops);
+	return 0;
+err:
+	kvfree(map);
+	guard_cache_destroy(gc);
+	return -ENOMEM;
+}
+EXPORT_SYMBOL_GPL(guard_cache_init);
+
+/*
+ * The caller must guarantee nobody else is using the cache anymore. Objects
+ * still allocated from slots are lost, they are reported. Also undoes a
+ * partial guard_cache_init().
+ */
+void guard_cache_destroy(struct guard_cache *gc)
+{
+	unsigned int i;
+
+	debugfs_remove(gc->debugfs);
+	gc->debugfs = NULL;
+
+	if (gc->nr_allocated)
+		PR_ERROR("%s: %u objects never freed\n", gc->name,
+			 gc->nr_allocated);
+	/* Unmapped PTEs are fine for vunmap() */
+	if (gc->pool)
+		vunmap(gc->pool);
+	gc->pool = NULL;
+
+	if (gc->pages) {
+		for (i = 0; i < gc->nr_slots; i++)
+			if (gc->pages[i])
+				__free_page(gc->pages[i]);
+	}
+	if (gc->guard)
+		__free_page(gc->guard);
+	kvfree(gc->pages);
+	kvfree(gc->slots);
+	free_percpu(gc->countdown);
+	gc->pages = NULL;
+	gc->slots = NULL;
+	gc->guard = NULL;
+	gc->countdown = NULL;
+}
+EXPORT_SYMBOL_GPL(guard_cache_destroy);
+
+static int __init guard_cache_module_init(void)
+{
+	guard_cache_debugfs = debugfs_create_dir("guard-cache", NULL);
+	return 0;
+}
+
+static void __exit guard_cache_module_exit(void)
+{
+	debugfs_remove_recursive(guard_cache_debugfs);
+}
+
+module_init(guard_cache_module_init);
+module_exit(guard_cache_module_exit);
+
+MODULE_AUTHOR("Bruno E. O. Meneguele <bmeneguele@gmail.com>");
+MODULE_DESCRIPTION("Sampling guarded allocator for use after free detection");
+MODULE_LICENSE("GPL");
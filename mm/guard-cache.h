@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2026 Bruno E. O. Meneguele <bmeneguele@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 2 as published by the
+ * Free Software Foundation.
+ */
+
+#ifndef __GUARD_CACHE_H
+#define __GUARD_CACHE_H
+
+#include <linux/types.h>
+#include <linux/list.h>
+#include <linux/percpu.h>
+#include <linux/spinlock.h>
+#include <linux/slab.h>
+#include <linux/mm.h>
+#include <linux/atomic.h>
+
+/*
+ * Sampling guarded allocator on top of a kmem_cache, in the spirit of KFENCE
+ * (mm/kfence in the kernel tree) but for the caches of a single module.
+ *
+ * Every 'sample_rate'th allocation on a CPU is served from a slot of a small
+ * pool instead of the backing cache. The pool is one vmap() area laid out as
+ * guard page, slot page, guard page, slot page... where guard pages are never
+ * mapped and free slots are unmapped as well:
+ * - an object is placed at the end of its slot page, so running past it
+ *   faults on the next guard page right away
+ * - the bytes in front of it are filled with a canary, checked on free, so
+ *   running before it is reported then
+ * - a freed slot is unmapped and goes to the tail of the free list, so a use
+ *   after free faults for as long as the slot isn't reused
+ * - freeing an object twice, or a pointer into a slot that isn't the object,
+ *   is reported and the free is ignored
+ *
+ * Faults end up as a regular kernel oops on an address inside the pool, the
+ * guard-cache/<name> debugfs file lists the pool range and, per slot, the
+ * object, its state and the stacks that allocated and freed it, to match the
+ * address against.
+ *
+ * The remaining allocations take the backing cache fast path, at the price of
+ * a per-CPU decrement, and frees of a range check. Objects can be allocated
+ * and freed from any context. The backing cache is owned by the user and must
+ * not have a constructor, objects larger than a page are never sampled.
+ *
+ * Like KFENCE, TLB entries are only flushed on the local CPU when a slot is
+ * unmapped (no IPI with interrupts disabled), another CPU might get away with
+ * an access through a stale entry for a short while. That takes invlpg, thus
+ * x86 only: flush_tlb_kernel_range() may IPI every CPU on other architectures,
+ * which deadlocks when frees happen with interrupts disabled.
+ */
+
+#define GUARD_CACHE_STACK_DEPTH	16
+
+enum guard_slot_state {
+	GUARD_SLOT_FREE,
+	GUARD_SLOT_ALLOCATED,
+};
+
+struct guard_slot {
+	/* Free list, only linked while free */
+	struct list_head list;
+	enum guard_slot_state state;
+	void *obj;
+	unsigned int nr_alloc_stack;
+	unsigned int nr_free_stack;
+	unsigned long alloc_stack[GUARD_CACHE_STACK_DEPTH];
+	unsigned long free_stack[GUARD_CACHE_STACK_DEPTH];
+};
+
+struct guard_cache_stats {
+	/* Allocations served by a slot */
+	unsigned long sampled;
+	/* Sampled allocations that found no free slot */
+	unsigned long exhausted;
+	/* Canary corruptions, double and invalid frees */
+	unsigned long errors;
+	unsigned int nr_allocated;
+};
+
+struct guard_cache {
+	const char *name;
+	/* Backing cache, owned by the guard cache user */
+	struct kmem_cache *cache;
+	unsigned int size;
+	/* Offset of the object in its slot page */
+	unsigned int offset;
+	/* 0 disables sampling */
+	unsigned int sample_rate;
+	/* Allocations left before the next sampled one */
+	unsigned int __percpu *countdown;
+
+	/* [guard][slot][guard]...[slot][guard], 2 * nr_slots + 1 pages */
+	void *pool;
+	unsigned int nr_slots;
+	struct page **pages;
+	/* Backs the guard pages in vmap(), never mapped after init */
+	struct page *guard;
+	struct guard_slot *slots;
+
+	raw_spinlock_t lock;
+	struct list_head free;
+	unsigned int nr_allocated;
+
+	atomic_long_t sampled;
+	atomic_long_t exhausted;
+	atomic_long_t errors;
+	struct dentry *debugfs;
+};
+
+int guard_cache_init(struct guard_cache *gc, const char *name,
+		     struct kmem_cache *cache, unsigned int align,
+		     unsigned int sample_rate, unsigned int nr_slots);
+void guard_cache_destroy(struct guard_cache *gc);
+void guard_cache_set_sample_rate(struct guard_cache *gc,
+				 unsigned int sample_rate);
+void guard_cache_get_stats(struct guard_cache *gc,
+			   struct guard_cache_stats *stats);
+
+void *__guard_cache_alloc_slow(struct guard_cache *gc, gfp_t gfp);
+void __guard_cache_free_slow(struct guard_cache *gc, void *obj);
+
+static inline bool guard_cache_owns(struct guard_cache *gc, const void *obj)
+{
+	return obj >= gc->pool &&
+	       obj < gc->pool + ((2UL * gc->nr_slots + 1) << PAGE_SHIFT);
+}
+
+static inline void *guard_cache_alloc(struct guard_cache *gc, gfp_t gfp)
+{
+	if (unlikely(READ_ONCE(gc->sample_rate) &&
+		     !this_cpu_dec_return(*gc->countdown)))
+		return __guard_cache_alloc_slow(gc, gfp);
+	return kmem_cache_alloc(gc->cache, gfp);
+}
+
+static inline void guard_cache_free(struct guard_cache *gc, void *obj)
+{
+	if (unlikely(guard_cache_owns(gc, obj)))
+		__guard_cache_free_slow(gc, obj);
+	else
+		kmem_cache_free(gc->cache, obj);
+}
+
+#endif /* __GUARD_CACHE_H */
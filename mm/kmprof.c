@@ -0,0 +1,360 @@
+/*
+ * Copyright (c) 2026 Bruno E. O. Meneguele <bmeneguele@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 2 as published by the
+ * Free Software Foundation.
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/percpu.h>
+#include <linux/xarray.h>
+#include <linux/hash.h>
+#include <linux/string.h>
+#include <linux/spinlock.h>
+#include <linux/mutex.h>
+#include <linux/ktime.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+
+#include "utils.h"
+#include "kmprof.h"
+
+/*
+ * Objects are mapped to their site and requested size by an xarray entry
+ * value: the site id in the low bits, the size above it.
+ */
+#define KMPROF_SITE_BITS	12
+#define KMPROF_MAX_SITES	(1U << KMPROF_SITE_BITS)
+#define KMPROF_MAX_SIZE		(LONG_MAX >> KMPROF_SITE_BITS)
+/* kmalloc objects are at least 8 bytes aligned */
+#define KMPROF_OBJ_SHIFT	3
+#define KMPROF_SHARD_BITS	4
+#define KMPROF_NR_SHARDS	(1U << KMPROF_SHARD_BITS)
+/*
+ * Live bytes are kept per-CPU and folded into the site counter past this
+ * much, which is where the peak is updated. The peak is thus off by up to
+ * KMPROF_BATCH bytes per CPU, good enough to spot who is holding memory.
+ */
+#define KMPROF_BATCH		(64 * 1024L)
+
+/* Only written by the owner CPU, through this_cpu ops */
+struct kmprof_cpu {
+	unsigned long allocs;
+	unsigned long frees;
+	/* Bytes asked for and bytes handed out by kmalloc (ksize()) */
+	unsigned long req;
+	unsigned long real;
+	unsigned long freed_req;
+	unsigned long freed_real;
+	/* Live bytes not folded into kmprof_site.live yet */
+	long live;
+};
+
+struct kmprof_site {
+	unsigned int id;
+	unsigned int line;
+	const char *file;
+	const char *func;
+	struct kmprof_cpu __percpu *cpu;
+	atomic_long_t live;
+	atomic_long_t peak;
+	/* Allocation rate is computed between two reads of the file */
+	unsigned long last_allocs;
+	u64 last_ns;
+};
+
+static DEFINE_XARRAY_ALLOC(kmprof_sites);
+static DEFINE_SPINLOCK(kmprof_sites_lock);
+static struct xarray kmprof_objs[KMPROF_NR_SHARDS];
+
+/* Allocations we couldn't map to a site, and frees of unknown objects */
+static atomic_long_t kmprof_untracked;
+static atomic_long_t kmprof_unknown_frees;
+
+static DEFINE_MUTEX(kmprof_show_lock);
+static struct dentry *kmprof_debugfs;
+
+static struct kmprof_site *kmprof_site_find(const char *file,
+					    unsigned int line)
+{
+	struct kmprof_site *site;
+	unsigned long id;
+
+	xa_for_each(&kmprof_sites, id, site)
+		if (site->line == line && !strcmp(site->file, file))
+			return site;
+	return NULL;
+}
+
+static void kmprof_site_free(struct kmprof_site *site)
+{
+	free_percpu(site->cpu);
+	kfree_const(site->file);
+	kfree_const(site->func);
+	kfree(site);
+}
+
+/*
+ * First allocation from a call site. Sites outlive the modules they belong
+ * to, so the strings are copied and a module loaded again picks up its old
+ * sites by file and line.
+ */
+static struct kmprof_site *kmprof_site_get(const char *file, unsigned int line,
+					   const char *func, gfp_t gfp)
+{
+	struct kmprof_site *site, *found;
+	unsigned long flags;
+	int err;
+
+	gfp = gfpflags_allow_blocking(gfp) ? GFP_KERNEL : GFP_NOWAIT;
+	site = kzalloc(sizeof(*site), gfp);
+	if (!site)
+		return NULL;
+	site->line = line;
+	site->file = kstrdup_const(file, gfp);
+	site->func = kstrdup_const(func, gfp);
+	site->cpu = alloc_percpu_gfp(struct kmprof_cpu, gfp);
+	site->last_ns = ktime_get_ns();
+	if (!site->file || !site->func || !site->cpu) {
+		kmprof_site_free(site);
+		return NULL;
+	}
+
+	spin_lock_irqsave(&kmprof_sites_lock, flags);
+	found = kmprof_site_find(file, line);
+	if (!found) {
+		err = xa_alloc(&kmprof_sites, &site->id, site,
+			       XA_LIMIT(0, KMPROF_MAX_SITES - 1), GFP_NOWAIT);
+		if (!err)
+			found = site;
+	}
+	spin_unlock_irqrestore(&kmprof_sites_lock, flags);
+
+	if (found != site)
+		kmprof_site_free(site);
+	return found;
+}
+
+static struct xarray *kmprof_shard(const void *obj)
+{
+	return &kmprof_objs[hash_ptr(obj, KMPROF_SHARD_BITS)];
+}
+
+static int kmprof_obj_store(const void *obj, struct kmprof_site *site,
+			    size_t size, gfp_t gfp)
+{
+	struct xarray *xa = kmprof_shard(obj);
+	unsigned long flags;
+	void *old;
+
+	/* xarray nodes come from a cache with a constructor */
+	gfp &= ~__GFP_ZERO;
+	xa_lock_irqsave(xa, flags);
+	old = __xa_store(xa, (unsigned long)obj >> KMPROF_OBJ_SHIFT,
+			 xa_mk_value(size << KMPROF_SITE_BITS | site->id),
+			 gfp | __GFP_NOWARN);
+	xa_unlock_irqrestore(xa, flags);
+
+	/* A previous object at this address was freed with plain kfree() */
+	if (old && !xa_is_err(old))
+		atomic_long_inc(&kmprof_unknown_frees);
+	return xa_err(old);
+}
+
+static void *kmprof_obj_erase(const void *obj)
+{
+	struct xarray *xa = kmprof_shard(obj);
+	unsigned long flags;
+	void *entry;
+
+	xa_lock_irqsave(xa, flags);
+	entry = __xa_erase(xa, (unsigned long)obj >> KMPROF_OBJ_SHIFT);
+	xa_unlock_irqrestore(xa, flags);
+	return entry;
+}
+
+static void kmprof_peak(struct kmprof_site *site, long live)
+{
+	long peak = atomic_long_read(&site->peak);
+
+	while (live > peak &&
+	       !atomic_long_try_cmpxchg(&site->peak, &peak, live))
+		;
+}
+
+void *__kmprof_alloc(struct kmprof_site **sitep, const char *file,
+		     unsigned int line, const char *func, size_t size,
+		     gfp_t gfp, int node)
+{
+	struct kmprof_site *site = READ_ONCE(*sitep);
+	size_t real;
+	void *obj;
+	long live;
+
+	obj = kmalloc_node(size, gfp, node);
+	if (ZERO_OR_NULL_PTR(obj))
+		return obj;
+
+	if (unlikely(!site)) {
+		site = kmprof_site_get(file, line, func, gfp);
+		if (!site)
+			goto untracked;
+		WRITE_ONCE(*sitep, site);
+	}
+	if (size > KMPROF_MAX_SIZE || kmprof_obj_store(obj, site, size, gfp))
+		goto untracked;
+
+	real = ksize(obj);
+	this_cpu_inc(site->cpu->allocs);
+	this_cpu_add(site->cpu->req, size);
+	this_cpu_add(site->cpu->real, real);
+	live = this_cpu_add_return(site->cpu->live, real);
+	if (unlikely(live > KMPROF_BATCH)) {
+		this_cpu_sub(site->cpu->live, live);
+		kmprof_peak(site, atomic_long_add_return(live, &site->live));
+	}
+	return obj;
+untracked:
+	atomic_long_inc(&kmprof_untracked);
+	return obj;
+}
+EXPORT_SYMBOL_GPL(__kmprof_alloc);
+
+void __kmprof_free(const void *obj)
+{
+	struct kmprof_site *site = NULL;
+	unsigned long val;
+	void *entry;
+	size_t real;
+	long live;
+
+	if (ZERO_OR_NULL_PTR(obj))
+		return;
+
+	entry = kmprof_obj_erase(obj);
+	if (entry) {
+		val = xa_to_value(entry);
+		site = xa_load(&kmprof_sites, val & (KMPROF_MAX_SITES - 1));
+	}
+	if (!site) {
+		atomic_long_inc(&kmprof_unknown_frees);
+		kfree(obj);
+		return;
+	}
+
+	real = ksize(obj);
+	this_cpu_inc(site->cpu->frees);
+	this_cpu_add(site->cpu->freed_req, val >> KMPROF_SITE_BITS);
+	this_cpu_add(site->cpu->freed_real, real);
+	live = this_cpu_sub_return(site->cpu->live, real);
+	if (unlikely(live < -KMPROF_BATCH)) {
+		this_cpu_sub(site->cpu->live, live);
+		atomic_long_add(live, &site->live);
+	}
+	kfree(obj);
+}
+EXPORT_SYMBOL_GPL(__kmprof_free);
+
+static void kmprof_show_site(struct seq_file *m, struct kmprof_site *site,
+			     u64 now)
+{
+	struct kmprof_cpu sum = { };
+	struct kmprof_cpu *pc;
+	unsigned long rate = 0;
+	long live;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		pc = per_cpu_ptr(site->cpu, cpu);
+		sum.allocs += READ_ONCE(pc->allocs);
+		sum.frees += READ_ONCE(pc->frees);
+		sum.req += READ_ONCE(pc->req);
+		sum.real += READ_ONCE(pc->real);
+		sum.freed_req += READ_ONCE(pc->freed_req);
+		sum.freed_real += READ_ONCE(pc->freed_real);
+		sum.live += READ_ONCE(pc->live);
+	}
+	live = atomic_long_read(&site->live) + sum.live;
+	kmprof_peak(site, live);
+
+	if (now > site->last_ns)
+		rate = div64_u64((u64)(sum.allocs - site->last_allocs) *
+				 NSEC_PER_SEC, now - site->last_ns);
+	site->last_allocs = sum.allocs;
+	site->last_ns = now;
+
+	/* Waste over the whole life of the site, rounding is per size class
+	 * so it rarely changes over time */
+	seq_printf(m, "%10lu %10lu %10lu %12ld %12lu %12ld %5lu%% %10lu "
+		   "%s:%u %s\n", sum.allocs, sum.frees, sum.allocs - sum.frees,
+		   live,
+		   (sum.real - sum.freed_real) - (sum.req - sum.freed_req),
+		   atomic_long_read(&site->peak),
+		   sum.real ? (sum.real - sum.req) * 100 / sum.real : 0,
+		   rate, kbasename(site->file), site->line, site->func);
+}
+
+static int kmprof_sites_show(struct seq_file *m, void *v)
+{
+	struct kmprof_site *site;
+	unsigned long id;
+	u64 now;
+
+	mutex_lock(&kmprof_show_lock);
+	seq_printf(m, "untracked allocs %ld, unknown frees %ld\n",
+		   atomic_long_read(&kmprof_untracked),
+		   atomic_long_read(&kmprof_unknown_frees));
+	seq_printf(m, "%10s %10s %10s %12s %12s %12s %6s %10s %s\n",
+		   "allocs", "frees", "live", "live_bytes", "live_waste",
+		   "peak_bytes", "waste", "allocs/s", "site");
+
+	now = ktime_get_ns();
+	xa_for_each(&kmprof_sites, id, site)
+		kmprof_show_site(m, site, now);
+	mutex_unlock(&kmprof_show_lock);
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(kmprof_sites);
+
+static int __init kmprof_init(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < KMPROF_NR_SHARDS; i++)
+		xa_init_flags(&kmprof_objs[i], XA_FLAGS_LOCK_IRQ);
+
+	kmprof_debugfs = debugfs_create_dir("kmprof", NULL);
+	debugfs_create_file("sites", 0444, kmprof_debugfs, NULL,
+			    &kmprof_sites_fops);
+	return 0;
+}
+
+/* Users hold a reference on us, their objects should be gone by now */
+static void __exit kmprof_exit(void)
+{
+	struct kmprof_site *site;
+	unsigned long id;
+	unsigned int i;
+
+	debugfs_remove_recursive(kmprof_debugfs);
+
+	for (i = 0; i < KMPROF_NR_SHARDS; i++) {
+		if (!xa_empty(&kmprof_objs[i]))
+			PR_ERROR("objects still mapped in shard %u\n", i);
+		xa_destroy(&kmprof_objs[i]);
+	}
+
+	xa_for_each(&kmprof_sites, id, site)
+		kmprof_site_free(site);
+	xa_destroy(&kmprof_sites);
+}
+
+module_init(kmprof_init);
+module_exit(kmprof_exit);
+
+MODULE_AUTHOR("Bruno E. O. Meneguele <bmeneguele@gmail.com>");
+MODULE_DESCRIPTION("Per call site kmalloc profiler");
+MODULE_LICENSE("GPL");
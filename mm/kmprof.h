@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2026 Bruno E. O. Meneguele <bmeneguele@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 2 as published by the
+ * Free Software Foundation.
+ */
+
+#ifndef __KMPROF_H
+#define __KMPROF_H
+
+#include <linux/types.h>
+#include <linux/slab.h>
+#include <linux/overflow.h>
+
+/*
+ * Per call site kmalloc profiler.
+ *
+ * kmalloc() rounds every request up to one of its size classes, a 280 bytes
+ * struct sits in kmalloc-512 and the 232 bytes left are lost for as long as
+ * the object lives. The kmprof_* wrappers below record, per call site, what
+ * was asked for against what ksize() says was handed out, and export it as
+ * kmprof/sites in debugfs: live objects and bytes, peak bytes, bytes wasted
+ * by the rounding and allocation rate.
+ *
+ * Counters are per-CPU, the only shared state touched by the fast paths is
+ * the map from object to call site needed by kmprof_kfree(), an xarray split
+ * in a few shards. Objects allocated through a kmprof_* wrapper must be freed
+ * with kmprof_kfree(), objects from plain kmalloc() may be passed to it too.
+ *
+ * Profiling is only built in with "make KMPROF=y", otherwise the wrappers are
+ * plain kmalloc()/kfree() and users don't depend on the kmprof module.
+ */
+
+struct kmprof_site;
+
+void *__kmprof_alloc(struct kmprof_site **sitep, const char *file,
+		     unsigned int line, const char *func, size_t size,
+		     gfp_t gfp, int node);
+void __kmprof_free(const void *obj);
+
+#ifdef MM_KMPROF
+
+/* Every expansion gets its own site, looked up once and cached */
+#define kmprof_kmalloc_node(size, gfp, node)				\
+({									\
+	static struct kmprof_site *__kmprof_site;			\
+	__kmprof_alloc(&__kmprof_site, __FILE__, __LINE__, __func__,	\
+		       (size), (gfp), (node));				\
+})
+#define kmprof_kfree(obj)		__kmprof_free(obj)
+
+#else /* !MM_KMPROF */
+
+#define kmprof_kmalloc_node(size, gfp, node)	kmalloc_node(size, gfp, node)
+#define kmprof_kfree(obj)			kfree(obj)
+
+#endif /* MM_KMPROF */
+
+#define kmprof_kmalloc(size, gfp)	\
+	kmprof_kmalloc_node(size, gfp, NUMA_NO_NODE)
+#define kmprof_kzalloc(size, gfp)	\
+	kmprof_kmalloc(size, (gfp) | __GFP_ZERO)
+#define kmprof_kzalloc_node(size, gfp, node)	\
+	kmprof_kmalloc_node(size, (gfp) | __GFP_ZERO, node)
+/* size_mul() saturates, an overflow ends up as a failed allocation */
+#define kmprof_kmalloc_array(n, size, gfp)	\
+	kmprof_kmalloc(size_mul(n, size), gfp)
+#define kmprof_kcalloc(n, size, gfp)	\
+	kmprof_kzalloc(size_mul(n, size), gfp)
+
+#endif /* __KMPROF_H */
@@ -0,0 +1,466 @@
+/*
+ * Copyright (c) 2026 Bruno E. O. Meneguele <bmeneguele@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 2 as published by the
+ * Free Software Foundation.
+ */
+
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/random.h>
+#include <linux/ktime.h>
+
+#ifdef CONFIG_X86_64
+#include <asm/cpufeature.h>
+#include <asm/fpu/api.h>
+#endif
+
+#include "utils.h"
+#include "bench.h"
+#include "my-alloc.h"
+
+/*
+ * The same records stored three ways:
+ * - AoS: struct test[], 12 bytes of data in 16 bytes objects
+ * - SoA: one array per field, u64 first[] and u32 second[]
+ * - packed: struct test without the tail padding, 12 bytes per record
+ *
+ * and three kernels run over each of them:
+ * - sum: sum of 'first'
+ * - filter: number of records with 'second' above a threshold
+ * - scan: sum of 'first' of the records passing the filter
+ *
+ * The kernel is built without SSE, so all of the C loops are scalar. On
+ * x86_64 the SoA layout also gets SSE2 and AVX2 versions, written in inline
+ * assembly like lib/raid6 does and run between kernel_fpu_begin() and
+ * kernel_fpu_end(). Every result is checked against the scalar AoS one.
+ *
+ * Example:
+ * insmod layout-bench.ko records=4194304 passes=20 selectivity=10
+ */
+static unsigned long records = 1UL << 20;
+module_param(records, ulong, 0444);
+MODULE_PARM_DESC(records, "Number of records");
+
+static unsigned int passes = 20;
+module_param(passes, uint, 0444);
+MODULE_PARM_DESC(passes, "Runs of every kernel");
+
+static unsigned int selectivity = 50;
+module_param(selectivity, uint, 0444);
+MODULE_PARM_DESC(selectivity, "Records passing the filter, in percent");
+
+/*
+ * kernel_fpu_begin() disables preemption, the SIMD loops give the CPU back
+ * every LAYOUT_FPU_CHUNK records.
+ */
+#define LAYOUT_FPU_CHUNK	(1UL << 16)
+
+struct test_packed {
+	u64 first;
+	u32 second;
+} __packed;
+
+struct layout_data {
+	unsigned long n;
+	struct test *aos;
+	u64 *first;
+	u32 *second;
+	struct test_packed *packed;
+};
+
+enum layout_op {
+	LAYOUT_SUM,
+	LAYOUT_FILTER,
+	LAYOUT_SCAN,
+	LAYOUT_NR_OPS,
+};
+
+static const char * const layout_op_names[] = {
+	[LAYOUT_SUM]	= "sum",
+	[LAYOUT_FILTER]	= "filter",
+	[LAYOUT_SCAN]	= "scan",
+};
+
+typedef u64 (*layout_fn_t)(struct layout_data *d, u32 t);
+
+struct layout_kernel {
+	const char *name;
+	enum layout_op op;
+	layout_fn_t fn;
+	bool avx2;
+};
+
+/* Keeps the compiler from dropping the kernels */
+static u64 layout_sink;
+
+#define LAYOUT_SCALAR(layout, first, second)				\
+static u64 layout##_sum(struct layout_data *d, u32 t)			\
+{									\
+	unsigned long i;						\
+	u64 sum = 0;							\
+									\
+	for (i = 0; i < d->n; i++)					\
+		sum += first;						\
+	return sum;							\
+}									\
+									\
+static u64 layout##_filter(struct layout_data *d, u32 t)		\
+{									\
+	unsigned long i;						\
+	u64 cnt = 0;							\
+									\
+	for (i = 0; i < d->n; i++)					\
+		cnt += second > t;					\
+	return cnt;							\
+}									\
+									\
+static u64 layout##_scan(struct layout_data *d, u32 t)			\
+{									\
+	unsigned long i;						\
+	u64 sum = 0;							\
+									\
+	for (i = 0; i < d->n; i++)					\
+		if (second > t)						\
+			sum += first;					\
+	return sum;							\
+}
+
+LAYOUT_SCALAR(aos, d->aos[i].first, d->aos[i].second)
+LAYOUT_SCALAR(soa, d->first[i], d->second[i])
+LAYOUT_SCALAR(packed, d->packed[i].first, d->packed[i].second)
+
+#ifdef CONFIG_X86_64
+/*
+ * The compares are signed (pcmpgtd), 'second' and the threshold are kept
+ * below 2^31 so they behave as unsigned ones.
+ */
+
+static u64 soa_sum_sse2(struct layout_data *d, u32 t)
+{
+	unsigned long i = 0, end, n = d->n & ~3UL;
+	u64 acc[2], sum = 0;
+
+	while (i < n) {
+		end = min(n, i + LAYOUT_FPU_CHUNK);
+		kernel_fpu_begin();
+		asm volatile("pxor %%xmm0,%%xmm0\n\t"
+			     "pxor %%xmm1,%%xmm1" : : );
+		for (; i < end; i += 4)
+			asm volatile("movdqu %0,%%xmm2\n\t"
+				     "paddq %%xmm2,%%xmm0\n\t"
+				     "movdqu %1,%%xmm3\n\t"
+				     "paddq %%xmm3,%%xmm1"
+				     : : "m" (d->first[i]),
+				     "m" (d->first[i + 2]));
+		asm volatile("paddq %%xmm1,%%xmm0\n\t"
+			     "movdqu %%xmm0,%0" : "=m" (acc));
+		kernel_fpu_end();
+		sum += acc[0] + acc[1];
+	}
+	for (; i < d->n; i++)
+		sum += d->first[i];
+	return sum;
+}
+
+static u64 soa_filter_sse2(struct layout_data *d, u32 t)
+{
+	unsigned long i = 0, end, n = d->n & ~3UL;
+	u32 cnt[4];
+	u64 sum = 0;
+
+	while (i < n) {
+		end = min(n, i + LAYOUT_FPU_CHUNK);
+		kernel_fpu_begin();
+		asm volatile("movd %0,%%xmm7\n\t"
+			     "pshufd $0,%%xmm7,%%xmm7\n\t"
+			     "pxor %%xmm0,%%xmm0" : : "m" (t));
+		/* Matching lanes are all ones, i.e. -1 */
+		for (; i < end; i += 4)
+			asm volatile("movdqu %0,%%xmm1\n\t"
+				     "pcmpgtd %%xmm7,%%xmm1\n\t"
+				     "psubd %%xmm1,%%xmm0"
+				     : : "m" (d->second[i]));
+		asm volatile("movdqu %%xmm0,%0" : "=m" (cnt));
+		kernel_fpu_end();
+		sum += (u64)cnt[0] + cnt[1] + cnt[2] + cnt[3];
+	}
+	for (; i < d->n; i++)
+		sum += d->second[i] > t;
+	return sum;
+}
+
+static u64 soa_scan_sse2(struct layout_data *d, u32 t)
+{
+	unsigned long i = 0, end, n = d->n & ~1UL;
+	u64 acc[2], sum = 0;
+
+	while (i < n) {
+		end = min(n, i + LAYOUT_FPU_CHUNK);
+		kernel_fpu_begin();
+		asm volatile("movd %0,%%xmm7\n\t"
+			     "pshufd $0,%%xmm7,%%xmm7\n\t"
+			     "pxor %%xmm0,%%xmm0" : : "m" (t));
+		/* Two 32 bits masks widened to 64 bits by duplicating them */
+		for (; i < end; i += 2)
+			asm volatile("movq %0,%%xmm1\n\t"
+				     "pcmpgtd %%xmm7,%%xmm1\n\t"
+				     "punpckldq %%xmm1,%%xmm1\n\t"
+				     "movdqu %1,%%xmm2\n\t"
+				     "pand %%xmm2,%%xmm1\n\t"
+				     "paddq %%xmm1,%%xmm0"
+				     : : "m" (d->second[i]), "m" (d->first[i]));
+		asm volatile("movdqu %%xmm0,%0" : "=m" (acc));
+		kernel_fpu_end();
+		sum += acc[0] + acc[1];
+	}
+	for (; i < d->n; i++)
+		if (d->second[i] > t)
+			sum += d->first[i];
+	return sum;
+}
+
+static u64 soa_sum_avx2(struct layout_data *d, u32 t)
+{
+	unsigned long i = 0, end, n = d->n & ~7UL;
+	u64 acc[4], sum = 0;
+
+	while (i < n) {
+		end = min(n, i + LAYOUT_FPU_CHUNK);
+		kernel_fpu_begin();
+		asm volatile("vpxor %%ymm0,%%ymm0,%%ymm0\n\t"
+			     "vpxor %%ymm1,%%ymm1,%%ymm1" : : );
+		for (; i < end; i += 8)
+			asm volatile("vpaddq %0,%%ymm0,%%ymm0\n\t"
+				     "vpaddq %1,%%ymm1,%%ymm1"
+				     : : "m" (d->first[i]),
+				     "m" (d->first[i + 4]));
+		asm volatile("vpaddq %%ymm1,%%ymm0,%%ymm0\n\t"
+			     "vmovdqu %%ymm0,%0" : "=m" (acc));
+		kernel_fpu_end();
+		sum += acc[0] + acc[1] + acc[2] + acc[3];
+	}
+	for (; i < d->n; i++)
+		sum += d->first[i];
+	return sum;
+}
+
+static u64 soa_filter_avx2(struct layout_data *d, u32 t)
+{
+	unsigned long i = 0, end, n = d->n & ~7UL;
+	u64 sum = 0;
+	u32 cnt[8];
+	int j;
+
+	while (i < n) {
+		end = min(n, i + LAYOUT_FPU_CHUNK);
+		kernel_fpu_begin();
+		asm volatile("vpbroadcastd %0,%%ymm7\n\t"
+			     "vpxor %%ymm0,%%ymm0,%%ymm0" : : "m" (t));
+		for (; i < end; i += 8)
+			asm volatile("vmovdqu %0,%%ymm1\n\t"
+				     "vpcmpgtd %%ymm7,%%ymm1,%%ymm1\n\t"
+				     "vpsubd %%ymm1,%%ymm0,%%ymm0"
+				     : : "m" (d->second[i]));
+		asm volatile("vmovdqu %%ymm0,%0" : "=m" (cnt));
+		kernel_fpu_end();
+		for (j = 0; j < 8; j++)
+			sum += cnt[j];
+	}
+	for (; i < d->n; i++)
+		sum += d->second[i] > t;
+	return sum;
+}
+
+static u64 soa_scan_avx2(struct layout_data *d, u32 t)
+{
+	unsigned long i = 0, end, n = d->n & ~3UL;
+	u64 acc[4], sum = 0;
+
+	while (i < n) {
+		end = min(n, i + LAYOUT_FPU_CHUNK);
+		kernel_fpu_begin();
+		asm volatile("vpbroadcastd %0,%%ymm7\n\t"
+			     "vpxor %%ymm0,%%ymm0,%%ymm0" : : "m" (t));
+		/* Four 32 bits masks sign extended to 64 bits */
+		for (; i < end; i += 4)
+			asm volatile("vmovdqu %0,%%xmm1\n\t"
+				     "vpcmpgtd %%xmm7,%%xmm1,%%xmm1\n\t"
+				     "vpmovsxdq %%xmm1,%%ymm1\n\t"
+				     "vpand %1,%%ymm1,%%ymm1\n\t"
+				     "vpaddq %%ymm1,%%ymm0,%%ymm0"
+				     : : "m" (d->second[i]), "m" (d->first[i]));
+		asm volatile("vmovdqu %%ymm0,%0" : "=m" (acc));
+		kernel_fpu_end();
+		sum += acc[0] + acc[1] + acc[2] + acc[3];
+	}
+	for (; i < d->n; i++)
+		if (d->second[i] > t)
+			sum += d->first[i];
+	return sum;
+}
+
+static bool layout_has_avx2(void)
+{
+	return boot_cpu_has(X86_FEATURE_AVX) &&
+	       boot_cpu_has(X86_FEATURE_AVX2) &&
+	       cpu_has_xfeatures(XFEATURE_MASK_SSE | XFEATURE_MASK_YMM, NULL);
+}
+#else
+static bool layout_has_avx2(void)
+{
+	return false;
+}
+#endif /* CONFIG_X86_64 */
+
+/*
+ * The first kernel of every operation is the scalar AoS one, it gives the
+ * reference result and timing. SSE2 is part of x86_64, AVX2 is checked.
+ */
+static const struct layout_kernel layout_kernels[] = {
+	{ "aos", LAYOUT_SUM, aos_sum },
+	{ "packed", LAYOUT_SUM, packed_sum },
+	{ "soa", LAYOUT_SUM, soa_sum },
+#ifdef CONFIG_X86_64
+	{ "soa sse2", LAYOUT_SUM, soa_sum_sse2 },
+	{ "soa avx2", LAYOUT_SUM, soa_sum_avx2, true },
+#endif
+	{ "aos", LAYOUT_FILTER, aos_filter },
+	{ "packed", LAYOUT_FILTER, packed_filter },
+	{ "soa", LAYOUT_FILTER, soa_filter },
+#ifdef CONFIG_X86_64
+	{ "soa sse2", LAYOUT_FILTER, soa_filter_sse2 },
+	{ "soa avx2", LAYOUT_FILTER, soa_filter_avx2, true },
+#endif
+	{ "aos", LAYOUT_SCAN, aos_scan },
+	{ "packed", LAYOUT_SCAN, packed_scan },
+	{ "soa", LAYOUT_SCAN, soa_scan },
+#ifdef CONFIG_X86_64
+	{ "soa sse2", LAYOUT_SCAN, soa_scan_sse2 },
+	{ "soa avx2", LAYOUT_SCAN, soa_scan_avx2, true },
+#endif
+};
+
+static void layout_data_free(struct layout_data *d)
+{
+	kvfree(d->aos);
+	kvfree(d->first);
+	kvfree(d->second);
+	kvfree(d->packed);
+}
+
+static int layout_data_alloc(struct layout_data *d, unsigned long n)
+{
+	unsigned long i;
+
+	d->n = n;
+	d->aos = kvmalloc_array(n, sizeof(*d->aos), GFP_KERNEL);
+	d->first = kvmalloc_array(n, sizeof(*d->first), GFP_KERNEL);
+	d->second = kvmalloc_array(n, sizeof(*d->second), GFP_KERNEL);
+	d->packed = kvmalloc_array(n, sizeof(*d->packed), GFP_KERNEL);
+	if (!d->aos || !d->first || !d->second || !d->packed) {
+		layout_data_free(d);
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < n; i++) {
+		d->first[i] = get_random_u32();
+		d->second[i] = get_random_u32() >> 1;
+		d->aos[i].first = d->packed[i].first = d->first[i];
+		d->aos[i].second = d->packed[i].second = d->second[i];
+		if (!(i & 0xffff))
+			cond_resched();
+	}
+	return 0;
+}
+
+static int layout_run(struct layout_data *d, u32 t)
+{
+	u64 ref[LAYOUT_NR_OPS], base_ns[LAYOUT_NR_OPS], start, ns, res = 0;
+	const struct layout_kernel *k;
+	unsigned int i, p;
+	bool first;
+
+	for (i = 0; i < ARRAY_SIZE(layout_kernels); i++) {
+		k = &layout_kernels[i];
+		first = !i || layout_kernels[i - 1].op != k->op;
+		if (k->avx2 && !layout_has_avx2()) {
+			PR_DEBUG("%-6s %-8s: not supported by the CPU\n",
+				 layout_op_names[k->op], k->name);
+			continue;
+		}
+
+		/* Warm up, which also gives the results to be checked */
+		res = k->fn(d, t);
+		if (first)
+			ref[k->op] = res;
+		else if (res != ref[k->op]) {
+			PR_ERROR("%s %s: got %llu, expected %llu\n",
+				 layout_op_names[k->op], k->name, res,
+				 ref[k->op]);
+			return -EIO;
+		}
+
+		start = ktime_get_ns();
+		for (p = 0; p < passes; p++) {
+			res += k->fn(d, t);
+			cond_resched();
+		}
+		ns = ktime_get_ns() - start;
+		if (first)
+			base_ns[k->op] = ns;
+
+		/* Speed up against AoS, scaled by 100 like the timings */
+		PR_DEBUG("%-6s %-8s: " BENCH_FP_FMT " ns/record, "
+			 BENCH_FP_FMT "x\n", layout_op_names[k->op], k->name,
+			 BENCH_FP_ARG(bench_ns_per_op(ns, (u64)passes * d->n)),
+			 BENCH_FP_ARG(bench_ns_per_op(base_ns[k->op], ns)));
+	}
+
+	WRITE_ONCE(layout_sink, res);
+	return 0;
+}
+
+static int __init layout_bench_init(void)
+{
+	struct layout_data d;
+	u32 t;
+	int err;
+
+	if (!records || !passes || selectivity > 100)
+		return -EINVAL;
+
+	err = layout_data_alloc(&d, records);
+	if (err)
+		return err;
+
+	/* 'second' is uniform in [0, 2^31) */
+	t = div_u64((1ULL << 31) * (100 - selectivity), 100);
+	if (t)
+		t--;
+
+	PR_DEBUG("%lu records, %u passes, %u%% selectivity: AoS %zu, packed "
+		 "%zu, SoA %zu bytes per record\n", records, passes,
+		 selectivity, sizeof(struct test), sizeof(struct test_packed),
+		 sizeof(u64) + sizeof(u32));
+	err = layout_run(&d, t);
+
+	layout_data_free(&d);
+	return err;
+}
+
+static void __exit layout_bench_exit(void)
+{
+	PR_DEBUG("module unloaded\n");
+}
+
+module_init(layout_bench_init);
+module_exit(layout_bench_exit);
+
+MODULE_AUTHOR("Bruno E. O. Meneguele <bmeneguele@gmail.com>");
+MODULE_DESCRIPTION("AoS versus SoA versus packed layouts of struct test");
+MODULE_LICENSE("GPL");
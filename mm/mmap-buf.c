@@ -0,0 +1,196 @@
+/*
+ * Copyright (c) 2026 Bruno E. O. Meneguele <bmeneguele@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 2 as published by the
+ * Free Software Foundation.
+ */
+
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/kernel.h>
+#include <linux/fs.h>
+#include <linux/miscdevice.h>
+#include <linux/mm.h>
+#include <linux/vmalloc.h>
+#include <linux/slab.h>
+
+#include "utils.h"
+
+/*
+ * Misc device exposing a kernel buffer both through read()/write(), which copy
+ * the data from/to userspace, and through mmap(), which maps the very same
+ * pages into the process so nothing is copied at all.
+ *
+ * The buffer is either vmalloc_user() memory, mapped with
+ * remap_vmalloc_range(), or an array of individually allocated pages, mapped
+ * with vm_insert_pages() and vmap()'ed for the kernel side accesses.
+ * There is no synchronization of the buffer contents, exactly like any other
+ * shared memory region. See userspace/mmap-bench.c for the benchmark.
+ *
+ * The device node is only accessible by root, the benchmark runs as root too.
+ *
+ * Example:
+ * insmod mmap-buf.ko buf_size=67108864 use_pages=1
+ */
+static unsigned long buf_size = 64UL << 20;
+module_param(buf_size, ulong, 0444);
+MODULE_PARM_DESC(buf_size, "Buffer size in bytes, rounded up to pages");
+
+static bool use_pages;
+module_param(use_pages, bool, 0444);
+MODULE_PARM_DESC(use_pages,
+		 "Back the buffer with alloc_page() pages instead of vmalloc");
+
+static void *buf;
+static struct page **buf_pages;
+static unsigned long buf_nr_pages;
+
+static loff_t mmap_buf_llseek(struct file *file, loff_t off, int whence)
+{
+	return fixed_size_llseek(file, off, whence, buf_size);
+}
+
+static ssize_t mmap_buf_read(struct file *file, char __user *ubuf,
+			     size_t count, loff_t *ppos)
+{
+	return simple_read_from_buffer(ubuf, count, ppos, buf, buf_size);
+}
+
+static ssize_t mmap_buf_write(struct file *file, const char __user *ubuf,
+			      size_t count, loff_t *ppos)
+{
+	return simple_write_to_buffer(buf, buf_size, ppos, ubuf, count);
+}
+
+static int mmap_buf_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	unsigned long size = vma->vm_end - vma->vm_start;
+	unsigned long nr = size >> PAGE_SHIFT;
+	int err;
+
+	if (vma->vm_pgoff > buf_nr_pages || nr > buf_nr_pages - vma->vm_pgoff)
+		return -EINVAL;
+
+	/* The mapping covers exactly the buffer: no mremap() growing it and no
+	 * kernel memory in core dumps */
+	vm_flags_set(vma, VM_DONTEXPAND | VM_DONTDUMP);
+
+	if (!use_pages)
+		return remap_vmalloc_range(vma, buf, vma->vm_pgoff);
+
+	/* Inserts all pages under a single page table lock, unlike one
+	 * vm_insert_page() call per page */
+	err = vm_insert_pages(vma, vma->vm_start, buf_pages + vma->vm_pgoff,
+			      &nr);
+	if (err)
+		return err;
+	return nr ? -EFAULT : 0;
+}
+
+static const struct file_operations mmap_buf_fops = {
+	.owner = THIS_MODULE,
+	.llseek = mmap_buf_llseek,
+	.read = mmap_buf_read,
+	.write = mmap_buf_write,
+	.mmap = mmap_buf_mmap,
+};
+
+static struct miscdevice mmap_buf_dev = {
+	.minor = MISC_DYNAMIC_MINOR,
+	.name = "mmap-buf",
+	.fops = &mmap_buf_fops,
+	/* Raw kernel memory, root only */
+	.mode = 0600,
+};
+
+static void mmap_buf_free(void)
+{
+	unsigned long i;
+
+	if (!use_pages) {
+		vfree(buf);
+		return;
+	}
+
+	if (buf)
+		vunmap(buf);
+	if (buf_pages) {
+		for (i = 0; i < buf_nr_pages; i++)
+			if (buf_pages[i])
+				__free_page(buf_pages[i]);
+		kvfree(buf_pages);
+	}
+}
+
+static int mmap_buf_alloc(void)
+{
+	unsigned long i;
+
+	if (!use_pages) {
+		/* Zeroed and flagged as mappable to userspace */
+		buf = vmalloc_user(buf_size);
+		return buf ? 0 : -ENOMEM;
+	}
+
+	buf_pages = kvcalloc(buf_nr_pages, sizeof(*buf_pages), GFP_KERNEL);
+	if (!buf_pages)
+		return -ENOMEM;
+
+	for (i = 0; i < buf_nr_pages; i++) {
+		/* Zeroed, nothing from the kernel leaks to userspace */
+		buf_pages[i] = alloc_page(GFP_KERNEL | __GFP_ZERO);
+		if (!buf_pages[i])
+			return -ENOMEM;
+	}
+
+	buf = vmap(buf_pages, buf_nr_pages, VM_MAP, PAGE_KERNEL);
+	return buf ? 0 : -ENOMEM;
+}
+
+static int __init mmap_buf_init(void)
+{
+	int err;
+
+	if (!buf_size)
+		return -EINVAL;
+	buf_size = PAGE_ALIGN(buf_size);
+	buf_nr_pages = buf_size >> PAGE_SHIFT;
+
+	err = mmap_buf_alloc();
+	if (err) {
+		PR_ERROR("failed to allocate %lu bytes\n", buf_size);
+		goto err_free;
+	}
+
+	err = misc_register(&mmap_buf_dev);
+	if (err) {
+		PR_ERROR("failed to register device\n");
+		goto err_free;
+	}
+
+	PR_DEBUG("/dev/%s: %lu bytes, %s backed\n", mmap_buf_dev.name,
+		 buf_size, use_pages ? "page" : "vmalloc");
+	return 0;
+
+err_free:
+	mmap_buf_free();
+	return err;
+}
+
+static void __exit mmap_buf_exit(void)
+{
+	/* A mapping holds a reference to the file, hence the module can't be
+	 * removed while any part of the buffer is still mapped */
+	misc_deregister(&mmap_buf_dev);
+	mmap_buf_free();
+	PR_DEBUG("module unloaded\n");
+}
+
+module_init(mmap_buf_init);
+module_exit(mmap_buf_exit);
+
+MODULE_AUTHOR("Bruno E. O. Meneguele <bmeneguele@gmail.com>");
+MODULE_DESCRIPTION("Zero-copy mmap()-able kernel buffer");
+MODULE_LICENSE("GPL");
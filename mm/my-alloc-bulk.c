@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2026 Bruno E. O. Meneguele <bmeneguele@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 2 as published by the
+ * Free Software Foundation.
+ */
+
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/kernel.h>
+#include <linux/slab.h>
+
+#include "utils.h"
+#include "bench.h"
+#include "my-alloc.h"
+
+/*
+ * Batched struct test allocation. kmem_cache_alloc_bulk() takes the per-CPU
+ * slab once (with interrupts disabled) for the whole batch instead of once per
+ * object, amortising the fast path overhead on bursts.
+ *
+ * All or nothing: returns 0 with 'nr' objects in 'objs', or -ENOMEM with none.
+ */
+int test_alloc_bulk(gfp_t gfp, size_t nr, struct test **objs)
+{
+	if (kmem_cache_alloc_bulk(test_cache, gfp, nr, (void **)objs) != nr)
+		return -ENOMEM;
+	return 0;
+}
+
+void test_free_bulk(size_t nr, struct test **objs)
+{
+	size_t i;
+
+	/* Back to the constructed state, see test_ctor() */
+	for (i = 0; i < nr; i++) {
+		objs[i]->first = 0;
+		objs[i]->second = 0;
+	}
+	kmem_cache_free_bulk(test_cache, nr, (void **)objs);
+}
+
+/*
+ * Example:
+ * insmod my-alloc.ko mode=bulk bulk_objs=10000000
+ */
+static unsigned int bulk_objs = 1000000;
+module_param(bulk_objs, uint, 0444);
+MODULE_PARM_DESC(bulk_objs, "Objects allocated per batch size and method");
+
+static const unsigned int bulk_sizes[] = { 1, 8, 32, 128 };
+
+#define BULK_MAX_BATCH		128
+
+enum bulk_method {
+	BULK_KMALLOC,
+	BULK_CACHE,
+	BULK_BULK,
+	BULK_NR_METHODS,
+};
+
+static const char * const bulk_method_names[] = {
+	[BULK_KMALLOC]	= "kmalloc",
+	[BULK_CACHE]	= "test_cache",
+	[BULK_BULK]	= "bulk",
+};
+
+static int bulk_batch(enum bulk_method method, struct test **objs,
+		      unsigned int nr)
+{
+	unsigned int i;
+
+	switch (method) {
+	case BULK_BULK:
+		if (test_alloc_bulk(GFP_KERNEL, nr, objs))
+			return -ENOMEM;
+		test_free_bulk(nr, objs);
+		return 0;
+	case BULK_CACHE:
+		for (i = 0; i < nr; i++) {
+			objs[i] = kmem_cache_alloc(test_cache, GFP_KERNEL);
+			if (unlikely(!objs[i]))
+				goto err;
+		}
+		for (i = 0; i < nr; i++) {
+			objs[i]->first = 0;
+			objs[i]->second = 0;
+			kmem_cache_free(test_cache, objs[i]);
+		}
+		return 0;
+	default:
+		for (i = 0; i < nr; i++) {
+			objs[i] = kmalloc(sizeof(struct test), GFP_KERNEL);
+			if (unlikely(!objs[i]))
+				goto err;
+		}
+		for (i = 0; i < nr; i++)
+			kfree(objs[i]);
+		return 0;
+	}
+
+err:
+	while (i--) {
+		if (method == BULK_CACHE)
+			kmem_cache_free(test_cache, objs[i]);
+		else
+			kfree(objs[i]);
+	}
+	return -ENOMEM;
+}
+
+int my_alloc_bulk_run(void)
+{
+	struct test *objs[BULK_MAX_BATCH];
+	unsigned int s, n, nr;
+	int method, err;
+	u64 start, ns;
+
+	if (!bulk_objs)
+		return -EINVAL;
+
+	for (s = 0; s < ARRAY_SIZE(bulk_sizes); s++) {
+		nr = bulk_sizes[s];
+		for (method = 0; method < BULK_NR_METHODS; method++) {
+			start = ktime_get_ns();
+			for (n = 0; n < bulk_objs; n += nr) {
+				err = bulk_batch(method, objs, nr);
+				if (err)
+					return err;
+				if ((n & 4095) < nr)
+					cond_resched();
+			}
+			ns = ktime_get_ns() - start;
+			PR_DEBUG("batch %3u %-10s " BENCH_FP_FMT " ns/obj\n", nr,
+				 bulk_method_names[method],
+				 BENCH_FP_ARG(bench_ns_per_op(ns, n)));
+		}
+	}
+	return 0;
+}
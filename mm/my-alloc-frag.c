@@ -0,0 +1,259 @@
+/*
+ * Copyright (c) 2026 Bruno E. O. Meneguele <bmeneguele@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 2 as published by the
+ * Free Software Foundation.
+ */
+
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/gfp.h>
+#include <linux/mm.h>
+#include <linux/list.h>
+#include <linux/xarray.h>
+#include <linux/sort.h>
+#include <linux/ktime.h>
+#include <linux/sched.h>
+#include <linux/delayacct.h>
+#include <linux/vmstat.h>
+
+#include "utils.h"
+#include "my-alloc.h"
+#include "kmprof.h"
+
+/*
+ * Fragmentation mode: grab 'frag_mb' of order-0 pages (with frag_all=1, as
+ * much as the allocator hands out without retrying hard), then give them back
+ * except one page in every 2^frag_stride pages aligned block. Kernel pages
+ * can't be migrated, so compaction can't do anything about the pinned ones and
+ * every block they sit in is useless for allocations of order frag_stride and
+ * up.
+ *
+ * Then, for orders 1 to 10, 'frag_tries' allocations are done with
+ * __GFP_RETRY_MAYFAIL, which retries hard but fails instead of invoking the
+ * OOM killer, and with __GFP_NORETRY, holding the pages until the end of the
+ * round so they can't be recycled. Reported are the latency percentiles,
+ * failures, direct compaction stalls and, with delay accounting enabled
+ * (sysctl kernel.task_delayacct=1), time spent compacting and reclaiming.
+ *
+ * This is meant to run in a throw-away VM, i.e.:
+ * insmod my-alloc.ko mode=frag frag_all=1 frag_stride=2 frag_tries=64
+ */
+static unsigned int frag_mb = 1024;
+module_param(frag_mb, uint, 0444);
+MODULE_PARM_DESC(frag_mb, "Memory to fragment in MiB");
+
+static bool frag_all;
+module_param(frag_all, bool, 0444);
+MODULE_PARM_DESC(frag_all, "Fragment all the memory it can get, not frag_mb");
+
+static unsigned int frag_stride = 3;
+module_param(frag_stride, uint, 0444);
+MODULE_PARM_DESC(frag_stride, "One page pinned per block of this order");
+
+static unsigned int frag_tries = 32;
+module_param(frag_tries, uint, 0444);
+MODULE_PARM_DESC(frag_tries, "Allocations per order and gfp mode");
+
+#define FRAG_MAX_ORDER		min(10, MAX_PAGE_ORDER)
+#define FRAG_MAX_TRIES		4096
+
+static const struct {
+	const char *name;
+	gfp_t gfp;
+} frag_gfps[] = {
+	{ "mayfail", GFP_KERNEL | __GFP_RETRY_MAYFAIL | __GFP_NOWARN },
+	{ "noretry", GFP_KERNEL | __GFP_NORETRY | __GFP_NOWARN },
+};
+
+/* What the allocator did on our behalf during a round */
+struct frag_cost {
+	u64 compact_ns;
+	u64 reclaim_ns;
+	unsigned long compact_stall;
+	unsigned long compact_fail;
+	unsigned long compact_success;
+};
+
+static void frag_cost_snapshot(struct frag_cost *c, unsigned long *events)
+{
+	memset(c, 0, sizeof(*c));
+#ifdef CONFIG_TASK_DELAY_ACCT
+	/* Only our own task updates these */
+	if (current->delays) {
+		c->compact_ns = current->delays->compact_delay;
+		c->reclaim_ns = current->delays->freepages_delay;
+	}
+#endif
+#if defined(CONFIG_VM_EVENT_COUNTERS) && defined(CONFIG_COMPACTION)
+	all_vm_events(events);
+	c->compact_stall = events[COMPACTSTALL];
+	c->compact_fail = events[COMPACTFAIL];
+	c->compact_success = events[COMPACTSUCCESS];
+#endif
+}
+
+/*
+ * Pin one page per 2^frag_stride block among the pages we got hold of, the
+ * xarray remembers which blocks are already pinned. Returns the number of
+ * pinned pages or a negative error, pinned pages are left on 'pinned' either
+ * way.
+ */
+static long frag_pin(struct list_head *pinned)
+{
+	unsigned long nr, target, kept = 0, freed = 0;
+	struct page *page, *tmp;
+	LIST_HEAD(grabbed);
+	DEFINE_XARRAY(blocks);
+	int err = 0;
+
+	target = frag_all ? ULONG_MAX :
+			    (unsigned long)frag_mb << (20 - PAGE_SHIFT);
+	for (nr = 0; nr < target; nr++) {
+		page = alloc_page(GFP_KERNEL | __GFP_NORETRY | __GFP_NOWARN);
+		if (!page)
+			break;
+		list_add(&page->lru, &grabbed);
+		if (!(nr & 1023))
+			cond_resched();
+	}
+
+	list_for_each_entry_safe(page, tmp, &grabbed, lru) {
+		list_del(&page->lru);
+		if (!err)
+			err = xa_insert(&blocks,
+					page_to_pfn(page) >> frag_stride,
+					xa_mk_value(0), GFP_KERNEL);
+		if (!err) {
+			list_add(&page->lru, pinned);
+			kept++;
+			continue;
+		}
+		/* Block already pinned */
+		if (err == -EBUSY)
+			err = 0;
+		/* On any other error the rest is given back as well */
+		__free_page(page);
+		freed++;
+	}
+	xa_destroy(&blocks);
+
+	if (err) {
+		PR_ERROR("failed to track pinned blocks: %d\n", err);
+		return err;
+	}
+	PR_DEBUG("grabbed %lu MiB, pinned %lu pages, one per order-%u block\n",
+		 (kept + freed) >> (20 - PAGE_SHIFT), kept, frag_stride);
+	return kept;
+}
+
+static void frag_unpin(struct list_head *pinned)
+{
+	struct page *page, *tmp;
+
+	list_for_each_entry_safe(page, tmp, pinned, lru) {
+		list_del(&page->lru);
+		__free_page(page);
+	}
+}
+
+static int frag_cmp_u64(const void *a, const void *b)
+{
+	u64 x = *(const u64 *)a, y = *(const u64 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static void frag_probe(unsigned int order, unsigned int g, u64 *samples,
+		       struct page **held, unsigned long *events)
+{
+	struct frag_cost before, after;
+	unsigned int i, n = 0;
+	u64 start;
+
+	frag_cost_snapshot(&before, events);
+	for (i = 0; i < frag_tries; i++) {
+		start = ktime_get_ns();
+		held[n] = alloc_pages(frag_gfps[g].gfp, order);
+		samples[i] = ktime_get_ns() - start;
+		if (held[n])
+			n++;
+		cond_resched();
+	}
+	frag_cost_snapshot(&after, events);
+
+	/* Failed attempts are part of the latency, they are what hurts when
+	 * __GFP_NORETRY callers fall back to smaller orders */
+	sort(samples, frag_tries, sizeof(*samples), frag_cmp_u64, NULL);
+	PR_DEBUG("order %2u %-7s: %u/%u failed, p50 %llu ns, p99 %llu ns, "
+		 "max %llu ns\n", order, frag_gfps[g].name, frag_tries - n,
+		 frag_tries, samples[frag_tries / 2],
+		 samples[frag_tries * 99 / 100], samples[frag_tries - 1]);
+	PR_DEBUG("order %2u %-7s: compaction %lu stalls (%lu ok, %lu failed) "
+		 "%llu us, reclaim %llu us\n", order, frag_gfps[g].name,
+		 after.compact_stall - before.compact_stall,
+		 after.compact_success - before.compact_success,
+		 after.compact_fail - before.compact_fail,
+		 div_u64(after.compact_ns - before.compact_ns, NSEC_PER_USEC),
+		 div_u64(after.reclaim_ns - before.reclaim_ns, NSEC_PER_USEC));
+
+	while (n--)
+		__free_pages(held[n], order);
+}
+
+int my_alloc_frag_run(void)
+{
+	unsigned long *events = NULL;
+	unsigned int order, g;
+	struct page **held;
+	LIST_HEAD(pinned);
+	long nr_pinned;
+	u64 *samples;
+	int err = -ENOMEM;
+
+	if (!frag_tries || frag_tries > FRAG_MAX_TRIES ||
+	    frag_stride > MAX_PAGE_ORDER || (!frag_mb && !frag_all))
+		return -EINVAL;
+
+	samples = kmprof_kmalloc_array(frag_tries, sizeof(*samples),
+				       GFP_KERNEL);
+	held = kmprof_kmalloc_array(frag_tries, sizeof(*held), GFP_KERNEL);
+#ifdef CONFIG_VM_EVENT_COUNTERS
+	events = kmprof_kmalloc_array(NR_VM_EVENT_ITEMS, sizeof(*events),
+				      GFP_KERNEL);
+	if (!events)
+		goto out;
+#endif
+	if (!samples || !held)
+		goto out;
+
+#ifdef CONFIG_TASK_DELAY_ACCT
+	if (!current->delays)
+		PR_DEBUG("no delay accounting, no compaction/reclaim time\n");
+#endif
+
+	nr_pinned = frag_pin(&pinned);
+	if (nr_pinned <= 0) {
+		if (!nr_pinned)
+			PR_ERROR("failed to pin any page\n");
+		else
+			err = nr_pinned;
+		frag_unpin(&pinned);
+		goto out;
+	}
+
+	for (order = 1; order <= FRAG_MAX_ORDER; order++)
+		for (g = 0; g < ARRAY_SIZE(frag_gfps); g++)
+			frag_probe(order, g, samples, held, events);
+
+	frag_unpin(&pinned);
+	err = 0;
+out:
+	kmprof_kfree(events);
+	kmprof_kfree(held);
+	kmprof_kfree(samples);
+	return err;
+}
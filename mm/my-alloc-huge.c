@@ -0,0 +1,266 @@
+/*
+ * Copyright (c) 2026 Bruno E. O. Meneguele <bmeneguele@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 2 as published by the
+ * Free Software Foundation.
+ */
+
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/gfp.h>
+#include <linux/mm.h>
+#include <linux/vmalloc.h>
+
+#include "utils.h"
+#include "bench.h"
+#include "my-alloc.h"
+#include "kmprof.h"
+
+/*
+ * Huge mode: a big struct test array (think of an index table) is backed by
+ * 4 KiB vmalloc pages, by order-9 compound pages reached through the direct
+ * map, and by vmalloc_huge() where the architecture supports huge vmap. Then
+ * a kthread does random reads over it, which is as bad as it gets for the TLB
+ * once the array is much larger than what the TLB covers with 4 KiB entries.
+ *
+ * Time per access and, when the PMU exposes them, dTLB read misses per access
+ * are reported for each backing. Inside a VM the generic cache events are
+ * often missing, in that case only the timing is shown. Example:
+ * insmod my-alloc.ko mode=huge huge_mb=1024
+ */
+static unsigned int huge_mb = 512;
+module_param(huge_mb, uint, 0444);
+MODULE_PARM_DESC(huge_mb, "Array size in MiB");
+
+static unsigned long huge_accesses = 16UL << 20;
+module_param(huge_accesses, ulong, 0444);
+MODULE_PARM_DESC(huge_accesses, "Random reads per backing");
+
+/* One PMD worth of pages, 2 MiB on x86_64 */
+#define HUGE_CHUNK_ORDER	min(PMD_SHIFT - PAGE_SHIFT, MAX_PAGE_ORDER)
+#define HUGE_CHUNK_SIZE		(PAGE_SIZE << HUGE_CHUNK_ORDER)
+#define HUGE_CHUNK_OBJS		(HUGE_CHUNK_SIZE / sizeof(struct test))
+
+enum huge_backing {
+	HUGE_VMALLOC,
+	HUGE_COMPOUND,
+	HUGE_VMALLOC_HUGE,
+	HUGE_NR_BACKINGS,
+};
+
+static const char * const huge_backing_names[] = {
+	[HUGE_VMALLOC]		= "vmalloc 4K",
+	[HUGE_COMPOUND]		= "order-9 pages",
+	[HUGE_VMALLOC_HUGE]	= "vmalloc_huge",
+};
+
+/*
+ * Whatever the backing, objects are reached through the chunk table, so every
+ * backing pays the same indexing cost and only the mappings differ.
+ */
+struct huge_array {
+	enum huge_backing backing;
+	unsigned long nr_objs;
+	unsigned int nr_chunks;
+	/* vmalloc'ed backings, NULL for compound pages */
+	void *vaddr;
+	struct test *chunks[];
+};
+
+struct huge_job {
+	struct huge_array *arr;
+	u64 misses;
+	bool counted;
+};
+
+/* Keeps the compiler from dropping the read loop */
+static u64 huge_sink;
+
+static inline struct test *huge_obj(struct huge_array *arr, unsigned long idx)
+{
+	return &arr->chunks[idx / HUGE_CHUNK_OBJS][idx % HUGE_CHUNK_OBJS];
+}
+
+static void huge_array_free(struct huge_array *arr)
+{
+	unsigned int i;
+
+	if (!arr)
+		return;
+
+	if (arr->backing != HUGE_COMPOUND) {
+		vfree(arr->vaddr);
+	} else {
+		for (i = 0; i < arr->nr_chunks; i++)
+			if (arr->chunks[i])
+				free_pages((unsigned long)arr->chunks[i],
+					   HUGE_CHUNK_ORDER);
+	}
+	kmprof_kfree(arr);
+}
+
+static struct huge_array *huge_array_alloc(enum huge_backing backing,
+					   unsigned long nr_objs)
+{
+	gfp_t gfp = GFP_KERNEL | __GFP_NOWARN;
+	unsigned long size, i;
+	struct huge_array *arr;
+	unsigned int nr_chunks;
+	struct page *page;
+
+	nr_chunks = DIV_ROUND_UP(nr_objs, HUGE_CHUNK_OBJS);
+	size = (unsigned long)nr_chunks * HUGE_CHUNK_SIZE;
+	arr = kmprof_kzalloc(struct_size(arr, chunks, nr_chunks), GFP_KERNEL);
+	if (!arr)
+		return NULL;
+
+	arr->backing = backing;
+	arr->nr_objs = nr_objs;
+	arr->nr_chunks = nr_chunks;
+
+	switch (backing) {
+	case HUGE_VMALLOC:
+		arr->vaddr = vmalloc(size);
+		break;
+	case HUGE_VMALLOC_HUGE:
+		/* Falls back to small pages when huge ones can't be had */
+		arr->vaddr = vmalloc_huge(size, gfp);
+		break;
+	case HUGE_COMPOUND:
+		for (i = 0; i < nr_chunks; i++) {
+			page = alloc_pages(gfp | __GFP_COMP, HUGE_CHUNK_ORDER);
+			if (!page)
+				goto err;
+			arr->chunks[i] = page_address(page);
+		}
+		break;
+	default:
+		goto err;
+	}
+
+	if (backing != HUGE_COMPOUND) {
+		if (!arr->vaddr)
+			goto err;
+		for (i = 0; i < nr_chunks; i++)
+			arr->chunks[i] = arr->vaddr + i * HUGE_CHUNK_SIZE;
+	}
+
+	for (i = 0; i < nr_objs; i++) {
+		huge_obj(arr, i)->first = i;
+		huge_obj(arr, i)->second = 0;
+		if (!(i & 0xffff))
+			cond_resched();
+	}
+	return arr;
+
+err:
+	huge_array_free(arr);
+	return NULL;
+}
+
+static int huge_thread(struct bench_thread *bt)
+{
+	struct huge_job *job = bt->run->data;
+	struct huge_array *arr = job->arr;
+	u64 start, enabled, running, sum = 0;
+	struct perf_event *ev;
+	unsigned long i;
+	u32 x = 2463534242;
+
+	ev = bench_perf_dtlb_create();
+	if (ev)
+		perf_event_enable(ev);
+
+	start = ktime_get_ns();
+	for (i = 0; i < huge_accesses; i++) {
+		/* xorshift32: cheap and independent from the loads, so they
+		 * can overlap and the TLB walks are what limits the loop */
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		sum += huge_obj(arr, reciprocal_scale(x, arr->nr_objs))->first;
+		if (!(i & 0xffff))
+			cond_resched();
+	}
+	bt->ns = ktime_get_ns() - start;
+	bt->ops = huge_accesses;
+
+	if (ev) {
+		perf_event_disable(ev);
+		job->misses = perf_event_read_value(ev, &enabled, &running);
+		job->counted = true;
+		perf_event_release_kernel(ev);
+	}
+
+	WRITE_ONCE(huge_sink, sum);
+	return 0;
+}
+
+static int huge_measure(struct huge_array *arr)
+{
+	struct huge_job job = { .arr = arr };
+	struct bench_run *run;
+	bool huge;
+	int err;
+
+	run = bench_run_alloc("my-alloc-huge",
+			      cpumask_of(cpumask_first(cpu_online_mask)), 1);
+	if (IS_ERR(run))
+		return PTR_ERR(run);
+
+	err = bench_run_exec(run, huge_thread, &job);
+	if (err)
+		goto out;
+
+	/* Compound pages sit in the direct map, which uses huge mappings */
+	huge = arr->backing == HUGE_COMPOUND ||
+	       (arr->vaddr && is_vm_area_hugepages(arr->vaddr));
+	if (job.counted)
+		PR_DEBUG("%-14s %s mappings: " BENCH_FP_FMT " ns/access, "
+			 BENCH_FP_FMT " dTLB misses/access\n",
+			 huge_backing_names[arr->backing], huge ? "huge" : "4K",
+			 BENCH_FP_ARG(bench_ns_per_op(run->threads[0].ns,
+						      huge_accesses)),
+			 BENCH_FP_ARG(bench_ns_per_op(job.misses,
+						      huge_accesses)));
+	else
+		PR_DEBUG("%-14s %s mappings: " BENCH_FP_FMT " ns/access, "
+			 "dTLB misses n/a\n", huge_backing_names[arr->backing],
+			 huge ? "huge" : "4K",
+			 BENCH_FP_ARG(bench_ns_per_op(run->threads[0].ns,
+						      huge_accesses)));
+out:
+	bench_run_free(run);
+	return err;
+}
+
+int my_alloc_huge_run(void)
+{
+	struct huge_array *arr;
+	unsigned long nr_objs;
+	int backing, err;
+
+	nr_objs = ((unsigned long)huge_mb << 20) / sizeof(struct test);
+	if (!nr_objs || nr_objs > U32_MAX || !huge_accesses)
+		return -EINVAL;
+
+	PR_DEBUG("%u MiB array, %lu objects, %lu random reads\n", huge_mb,
+		 nr_objs, huge_accesses);
+	for (backing = 0; backing < HUGE_NR_BACKINGS; backing++) {
+		arr = huge_array_alloc(backing, nr_objs);
+		if (!arr) {
+			/* Order-9 pages may be gone on a fragmented box */
+			PR_ERROR("%s: failed to allocate %u MiB\n",
+				 huge_backing_names[backing], huge_mb);
+			continue;
+		}
+		err = huge_measure(arr);
+		huge_array_free(arr);
+		if (err)
+			return err;
+	}
+	return 0;
+}
@@ -0,0 +1,330 @@
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/mm.h>
+#include <linux/debugfs.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/string.h>
+
+#include "utils.h"
+#include "my-alloc.h"
+
+/*
+ * Dedicated cache tunables. Example:
+ * insmod my-alloc.ko cache_hwalign=1 bench_objs=1000000
+ */
+static bool cache_hwalign;
+module_param(cache_hwalign, bool, 0444);
+MODULE_PARM_DESC(cache_hwalign,
+		 "Align struct test objects to hardware cachelines");
+
+static unsigned int cache_align;
+module_param(cache_align, uint, 0444);
+MODULE_PARM_DESC(cache_align,
+		 "Explicit struct test object alignment in bytes (0 = default)");
+
+static bool pgref;
+module_param(pgref, bool, 0444);
+MODULE_PARM_DESC(pgref, "Trace watched pages refcount, see my-alloc/pgref");
+
+static unsigned int bench_objs;
+module_param(bench_objs, uint, 0444);
+MODULE_PARM_DESC(bench_objs,
+		 "Objects allocated/freed per benchmark run (0 = no benchmark)");
+
+/*
+ * Benchmark mode run after the basic tests. Example:
+ * insmod my-alloc.ko mode=numa
+ */
+static char *mode;
+module_param(mode, charp, 0444);
+MODULE_PARM_DESC(mode,
+		 "Benchmark mode: numa, stress, remote, bulk, huge, frag, memcg");
+
+static const struct my_alloc_mode my_alloc_modes[] = {
+	{ "numa", my_alloc_numa_run },
+	{ "stress", my_alloc_stress_run },
+	{ "remote", my_alloc_remote_run },
+	{ "bulk", my_alloc_bulk_run },
+	{ "huge", my_alloc_huge_run },
+	{ "frag", my_alloc_frag_run },
+	{ "memcg", my_alloc_memcg_run },
+};
+
+/*
+ * kmalloc() serves requests from generic size classes shared by the whole
+ * kernel, thus a 16 bytes struct test ends up in kmalloc-16 side by side with
+ * any other small allocation. A dedicated cache keeps our objects together in
+ * their own slabs and lets us choose how they are laid out.
+ */
+struct kmem_cache *test_cache;
+
+struct dentry *my_alloc_debugfs;
+
+/*
+ * The constructor runs once per object when a new slab is populated, not on
+ * every kmem_cache_alloc(), hence objects must be given back to the cache in
+ * this same state. Having a constructor also prevents SLUB from merging our
+ * cache with a compatible generic one (i.e. kmalloc-16 itself).
+ */
+static void test_ctor(void *obj)
+{
+	struct test *t = obj;
+
+	t->first = 0;
+	t->second = 0;
+}
+
+static int test_cache_create(void)
+{
+	slab_flags_t flags = 0;
+
+	if (cache_hwalign)
+		flags |= SLAB_HWCACHE_ALIGN;
+
+	test_cache = kmem_cache_create("test_cache", sizeof(struct test),
+				       cache_align, flags, test_ctor);
+	if (!test_cache)
+		return -ENOMEM;
+
+	/* struct test carries 12 bytes, the rest of the object is padding */
+	if (slabinfo_add(test_cache, "test_cache",
+			 offsetofend(struct test, second)))
+		PR_ERROR("test_cache not reported in slabinfo\n");
+
+	PR_DEBUG("test_cache: object size %u, alignment %u, hwalign %s\n",
+		 kmem_cache_size(test_cache), cache_align,
+		 cache_hwalign ? "true" : "false");
+	return 0;
+}
+
+enum test_alloc_kind {
+	TEST_ALLOC_KMALLOC,
+	TEST_ALLOC_CACHE,
+};
+
+static const char * const test_alloc_names[] = {
+	[TEST_ALLOC_KMALLOC]	= "kmalloc",
+	[TEST_ALLOC_CACHE]	= "test_cache",
+};
+
+/* A switch instead of function pointers: indirect calls (and retpolines) would
+ * cost as much as the allocation fast path we are trying to measure. */
+static __always_inline struct test *test_alloc(enum test_alloc_kind kind)
+{
+	if (kind == TEST_ALLOC_CACHE)
+		return kmem_cache_alloc(test_cache, GFP_KERNEL);
+	return kmalloc(sizeof(struct test), GFP_KERNEL);
+}
+
+static __always_inline void test_free(enum test_alloc_kind kind,
+				      struct test *t)
+{
+	if (kind == TEST_ALLOC_CACHE) {
+		/* Back to the constructed state, see test_ctor() */
+		t->first = 0;
+		t->second = 0;
+		kmem_cache_free(test_cache, t);
+	} else {
+		kfree(t);
+	}
+}
+
+/* Print ns per operation with two decimal places */
+static void test_bench_report(const char *what, enum test_alloc_kind kind,
+			      u64 ns, unsigned int ops)
+{
+	u64 cns = div_u64(ns * 100, ops);
+
+	PR_DEBUG("%-10s %-6s %u ops: %llu.%02llu ns/op\n",
+		 test_alloc_names[kind], what, ops,
+		 div_u64(cns, 100), cns % 100);
+}
+
+/*
+ * Two access patterns are measured: a burst, where every object is allocated
+ * before any of them is freed, forcing the allocator to go through new slabs;
+ * and alloc/free pairs, which stay on the per-CPU fast path.
+ */
+static int test_bench_run(enum test_alloc_kind kind, struct test **objs,
+			  unsigned int n)
+{
+	u64 start, alloc_ns, free_ns, pair_ns;
+	unsigned int i;
+
+	start = ktime_get_ns();
+	for (i = 0; i < n; i++) {
+		objs[i] = test_alloc(kind);
+		if (unlikely(!objs[i]))
+			goto err_free;
+	}
+	alloc_ns = ktime_get_ns() - start;
+
+	start = ktime_get_ns();
+	for (i = 0; i < n; i++)
+		test_free(kind, objs[i]);
+	free_ns = ktime_get_ns() - start;
+
+	start = ktime_get_ns();
+	for (i = 0; i < n; i++) {
+		objs[0] = test_alloc(kind);
+		if (unlikely(!objs[0]))
+			return -ENOMEM;
+		test_free(kind, objs[0]);
+	}
+	pair_ns = ktime_get_ns() - start;
+
+	test_bench_report("alloc", kind, alloc_ns, n);
+	test_bench_report("free", kind, free_ns, n);
+	test_bench_report("pair", kind, pair_ns, n);
+	return 0;
+
+err_free:
+	while (i--)
+		test_free(kind, objs[i]);
+	return -ENOMEM;
+}
+
+static int test_bench(void)
+{
+	struct test **objs;
+	int err;
+
+	objs = kvmalloc_array(bench_objs, sizeof(*objs), GFP_KERNEL);
+	if (!objs)
+		return -ENOMEM;
+
+	/* kmalloc goes first as the baseline */
+	err = test_bench_run(TEST_ALLOC_KMALLOC, objs, bench_objs);
+	if (!err)
+		err = test_bench_run(TEST_ALLOC_CACHE, objs, bench_objs);
+	if (err)
+		PR_ERROR("benchmark failed: %d\n", err);
+
+	kvfree(objs);
+	return err;
+}
+
+static int my_alloc_mode_run(void)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(my_alloc_modes); i++) {
+		if (!strcmp(mode, my_alloc_modes[i].name)) {
+			PR_DEBUG("running mode %s\n", mode);
+			return my_alloc_modes[i].run();
+		}
+	}
+
+	PR_ERROR("unknown mode: %s\n", mode);
+	return -EINVAL;
+}
+
+/*
+ * Copying a pointer doesn't take a page reference, get_page() does. With the
+ * tracer enabled (pgref=1) every get/put done to the pages watched below, by
+ * us or by anyone else, is accounted in my-alloc/pgref.
+ */
+static void test_pgref_demo(struct test *t)
+{
+	struct page *any_page;
+
+	/* The slab page holding 't': it stays alive as long as the slab does */
+	pgref_watch(virt_to_page(t));
+
+	any_page = alloc_page(GFP_KERNEL);
+	if (!any_page)
+		return;
+	pgref_watch(any_page);
+	get_page(any_page);
+	get_page(any_page);
+	put_page(any_page);
+	put_page(any_page);
+	/* Last reference: the tracer accounts lifetime and peak refcount */
+	__free_page(any_page);
+}
+
+static int __init my_module_init(void)
+{
+	struct test *lets_go, *lets_stop;
+	int err;
+
+	PR_DEBUG("hello world!\n");
+
+	err = test_cache_create();
+	if (err) {
+		PR_ERROR("failed to create test_cache\n");
+		return err;
+	}
+
+	my_alloc_debugfs = debugfs_create_dir("my-alloc", NULL);
+	slabinfo_debugfs_init();
+	if (pgref) {
+		err = pgref_trace_start();
+		if (err)
+			goto err;
+	}
+
+	/* kmalloc allocates contiguous address directly in physical memory. To
+	 * allocate virtually contiguous memory vmalloc should be used. But due
+	 * to the amount of performance lost with vmalloc, kernel code tend to
+	 * use kmalloc more often, although there are moments that vmalloc are
+	 * necessary, i.e. when user requests memory allocation. */
+	lets_go = kmalloc(sizeof(struct test), GFP_KERNEL);
+
+	/* In case of error kmalloc returns NULL, because of that is mandatory
+	 * check its return value. */
+	if (!lets_go) {
+		PR_ERROR("allocation to allowed\n");
+		err = -ENOMEM;
+		goto err;
+	}
+
+	lets_go->first = 1;
+	lets_go->second = 2;
+	PR_DEBUG("%p\n", lets_go);
+	PR_DEBUG("%lld, %d\n", lets_go->first, lets_go->second);
+	lets_stop = lets_go;
+	test_pgref_demo(lets_stop);
+
+	kfree(lets_go);
+
+	if (bench_objs) {
+		err = test_bench();
+		if (err)
+			goto err;
+	}
+
+	if (mode) {
+		err = my_alloc_mode_run();
+		if (err)
+			goto err;
+	}
+
+	return 0;
+err:
+	debugfs_remove_recursive(my_alloc_debugfs);
+	pgref_trace_stop();
+	slabinfo_del(test_cache);
+	kmem_cache_destroy(test_cache);
+	return err;
+}
+
+static void __exit my_module_exit(void)
+{
+	debugfs_remove_recursive(my_alloc_debugfs);
+	pgref_trace_stop();
+	slabinfo_del(test_cache);
+	kmem_cache_destroy(test_cache);
+	PR_DEBUG("bye world!\n");
+}
+
+module_init(my_module_init);
+module_exit(my_module_exit);
+
+MODULE_AUTHOR("Bruno E. O. Meneguele <bmeneguele@gmail.com>");
+MODULE_DESCRIPTION("Module to start my kernel studies");
+MODULE_LICENSE("GPL");
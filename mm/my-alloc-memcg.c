@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2026 Bruno E. O. Meneguele <bmeneguele@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 2 as published by the
+ * Free Software Foundation.
+ */
+
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/memcontrol.h>
+
+#include "utils.h"
+#include "bench.h"
+#include "my-alloc.h"
+#include "kmprof.h"
+
+/*
+ * Memory cgroup accounting mode: the same struct test allocations from a
+ * cache created with and without SLAB_ACCOUNT, and from kmalloc with and
+ * without __GFP_ACCOUNT (which use the separate kmalloc-cg-* caches).
+ *
+ * Charges go to the memcg of the current task, the one running insmod. The
+ * root cgroup is never charged, thus this must run from a child cgroup of a
+ * cgroup v2 hierarchy with the memory controller enabled, run.sh does it with
+ * MEMCG=y:
+ * MEMCG=y ./run.sh mode=memcg memcg_objs=1000000
+ *
+ * Every object is charged on allocation and uncharged on free, but the memcg
+ * code keeps per-CPU stocks of pre-charged bytes and pages so most of them
+ * don't touch the shared page counters. Holding more objects per batch
+ * drains those stocks faster, so the batch sizes go way beyond the per-CPU
+ * slab sizes here.
+ */
+static unsigned int memcg_objs = 1000000;
+module_param(memcg_objs, uint, 0444);
+MODULE_PARM_DESC(memcg_objs, "Objects allocated per batch size and method");
+
+static const unsigned int memcg_sizes[] = { 1, 8, 32, 128, 1024, 8192 };
+
+#define MEMCG_MAX_BATCH		8192
+
+enum memcg_method {
+	MEMCG_CACHE,
+	MEMCG_BULK,
+	MEMCG_KMALLOC,
+	MEMCG_NR_METHODS,
+};
+
+static const char * const memcg_method_names[] = {
+	[MEMCG_CACHE]	= "cache",
+	[MEMCG_BULK]	= "bulk",
+	[MEMCG_KMALLOC]	= "kmalloc",
+};
+
+/* [0] plain, [1] accounted */
+static struct kmem_cache *memcg_caches[2];
+
+static int memcg_batch(enum memcg_method method, bool account, void **objs,
+		       unsigned int nr)
+{
+	struct kmem_cache *cache = memcg_caches[account];
+	gfp_t gfp = account ? GFP_KERNEL_ACCOUNT : GFP_KERNEL;
+	unsigned int i;
+
+	switch (method) {
+	case MEMCG_BULK:
+		/* The cache flag is what matters, not the gfp */
+		if (kmem_cache_alloc_bulk(cache, GFP_KERNEL, nr, objs) != nr)
+			return -ENOMEM;
+		kmem_cache_free_bulk(cache, nr, objs);
+		return 0;
+	case MEMCG_CACHE:
+		for (i = 0; i < nr; i++) {
+			objs[i] = kmem_cache_alloc(cache, GFP_KERNEL);
+			if (unlikely(!objs[i]))
+				goto err;
+		}
+		for (i = 0; i < nr; i++)
+			kmem_cache_free(cache, objs[i]);
+		return 0;
+	default:
+		for (i = 0; i < nr; i++) {
+			objs[i] = kmalloc(sizeof(struct test), gfp);
+			if (unlikely(!objs[i]))
+				goto err;
+		}
+		for (i = 0; i < nr; i++)
+			kfree(objs[i]);
+		return 0;
+	}
+
+err:
+	while (i--) {
+		if (method == MEMCG_CACHE)
+			kmem_cache_free(cache, objs[i]);
+		else
+			kfree(objs[i]);
+	}
+	return -ENOMEM;
+}
+
+/* ns per object, scaled by 100 */
+static int memcg_measure(enum memcg_method method, bool account, void **objs,
+			 unsigned int nr, u64 *ns_per_obj)
+{
+	unsigned int n;
+	u64 start;
+	int err;
+
+	start = ktime_get_ns();
+	for (n = 0; n < memcg_objs; n += nr) {
+		err = memcg_batch(method, account, objs, nr);
+		if (err)
+			return err;
+		if ((n & 4095) < nr)
+			cond_resched();
+	}
+	*ns_per_obj = bench_ns_per_op(ktime_get_ns() - start, n);
+	return 0;
+}
+
+/* Whether allocations made by current are charged to anything */
+static bool memcg_charged(void)
+{
+	struct obj_cgroup *objcg = get_obj_cgroup_from_current();
+
+	if (!objcg)
+		return false;
+	obj_cgroup_put(objcg);
+	return true;
+}
+
+int my_alloc_memcg_run(void)
+{
+	unsigned int s, nr, a;
+	u64 ns[2], overhead;
+	int method, err = 0;
+	void **objs;
+
+	if (!memcg_objs)
+		return -EINVAL;
+
+	if (!memcg_charged())
+		PR_ERROR("root cgroup or no kmem accounting, nothing will be "
+			 "charged, see MEMCG=y in run.sh\n");
+
+	/* Not merged with other caches, nor with each other */
+	memcg_caches[0] = kmem_cache_create("memcg_plain", sizeof(struct test),
+					    0, SLAB_NO_MERGE, NULL);
+	memcg_caches[1] = kmem_cache_create("memcg_account",
+					    sizeof(struct test), 0,
+					    SLAB_NO_MERGE | SLAB_ACCOUNT, NULL);
+	objs = kmprof_kmalloc_array(MEMCG_MAX_BATCH, sizeof(*objs),
+				    GFP_KERNEL);
+	if (!memcg_caches[0] || !memcg_caches[1] || !objs) {
+		err = -ENOMEM;
+		goto out;
+	}
+
+	PR_DEBUG("%u objects per batch size and method, ns/obj plain, "
+		 "accounted and charging overhead\n", memcg_objs);
+	for (s = 0; s < ARRAY_SIZE(memcg_sizes); s++) {
+		nr = memcg_sizes[s];
+		for (method = 0; method < MEMCG_NR_METHODS; method++) {
+			for (a = 0; a < 2; a++) {
+				err = memcg_measure(method, a, objs, nr,
+						    &ns[a]);
+				if (err)
+					goto out;
+			}
+			overhead = ns[1] > ns[0] ? ns[1] - ns[0] : 0;
+			PR_DEBUG("batch %4u %-8s " BENCH_FP_FMT " "
+				 BENCH_FP_FMT " +" BENCH_FP_FMT " ns/obj\n",
+				 nr, memcg_method_names[method],
+				 BENCH_FP_ARG(ns[0]), BENCH_FP_ARG(ns[1]),
+				 BENCH_FP_ARG(overhead));
+		}
+	}
+
+out:
+	kmprof_kfree(objs);
+	/* NULL is fine */
+	kmem_cache_destroy(memcg_caches[1]);
+	kmem_cache_destroy(memcg_caches[0]);
+	return err;
+}
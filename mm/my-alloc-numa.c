@@ -0,0 +1,272 @@
+/*
+ * Copyright (c) 2026 Bruno E. O. Meneguele <bmeneguele@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 2 as published by the
+ * Free Software Foundation.
+ */
+
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/gfp.h>
+#include <linux/mm.h>
+#include <linux/nodemask.h>
+#include <linux/topology.h>
+
+#include "utils.h"
+#include "bench.h"
+#include "my-alloc.h"
+#include "kmprof.h"
+
+/*
+ * NUMA mode: one struct test array is allocated on every memory node, then a
+ * kthread bound to a CPU of every node streams through (read and write) and
+ * pointer chases each array. Pairs are measured one at a time, so the numbers
+ * show the local versus remote access cost and not interconnect contention.
+ *
+ * On a single node box the matrix is 1x1. A multi node topology can be
+ * emulated with QEMU, i.e.:
+ * -smp 4 -m 4G -object memory-backend-ram,id=m0,size=2G \
+ *  -object memory-backend-ram,id=m1,size=2G \
+ *  -numa node,nodeid=0,cpus=0-1,memdev=m0 \
+ *  -numa node,nodeid=1,cpus=2-3,memdev=m1
+ * or on the host kernel command line with numa=fake=2 (CONFIG_NUMA_EMU).
+ */
+static unsigned long numa_objs = 4UL << 20;
+module_param(numa_objs, ulong, 0444);
+MODULE_PARM_DESC(numa_objs, "struct test objects per node array");
+
+static unsigned int numa_passes = 8;
+module_param(numa_passes, uint, 0444);
+MODULE_PARM_DESC(numa_passes, "Read/write passes over each array");
+
+/*
+ * Big arrays are made of 2 MiB page blocks, accessed through the kernel
+ * direct map, so huge TLB entries are used like a kmalloc'ed buffer would.
+ */
+#define NUMA_CHUNK_ORDER	min(9, MAX_PAGE_ORDER)
+#define NUMA_CHUNK_SIZE		(PAGE_SIZE << NUMA_CHUNK_ORDER)
+#define NUMA_CHUNK_OBJS		(NUMA_CHUNK_SIZE / sizeof(struct test))
+
+struct numa_array {
+	int node;
+	unsigned long nr_objs;
+	unsigned int nr_chunks;
+	/* Small arrays fit a single kmalloc_node() buffer */
+	bool kmalloced;
+	struct test *chunks[];
+};
+
+/* Measurement of one CPU node against one memory node */
+struct numa_job {
+	struct numa_array *arr;
+	u64 read_ns;
+	u64 write_ns;
+	u64 chase_ns;
+};
+
+/* Keeps the compiler from dropping the read loops */
+static u64 numa_sink;
+
+static inline struct test *numa_obj(struct numa_array *arr, unsigned long idx)
+{
+	return &arr->chunks[idx / NUMA_CHUNK_OBJS][idx % NUMA_CHUNK_OBJS];
+}
+
+static void numa_array_free(struct numa_array *arr)
+{
+	unsigned int i;
+
+	if (!arr)
+		return;
+
+	if (arr->kmalloced) {
+		kmprof_kfree(arr->chunks[0]);
+	} else {
+		for (i = 0; i < arr->nr_chunks; i++)
+			if (arr->chunks[i])
+				free_pages((unsigned long)arr->chunks[i],
+					   NUMA_CHUNK_ORDER);
+	}
+	kmprof_kfree(arr);
+}
+
+static struct numa_array *numa_array_alloc(int node, unsigned long nr_objs)
+{
+	/* __GFP_THISNODE: better failing than silently measuring another node */
+	gfp_t gfp = GFP_KERNEL | __GFP_THISNODE | __GFP_NOWARN;
+	struct numa_array *arr;
+	unsigned int i, nr_chunks;
+	struct page *page;
+
+	nr_chunks = DIV_ROUND_UP(nr_objs, NUMA_CHUNK_OBJS);
+	arr = kmprof_kzalloc_node(struct_size(arr, chunks, nr_chunks),
+				  GFP_KERNEL, node);
+	if (!arr)
+		return NULL;
+
+	arr->node = node;
+	arr->nr_objs = nr_objs;
+	arr->nr_chunks = nr_chunks;
+
+	if (nr_objs * sizeof(struct test) <= KMALLOC_MAX_CACHE_SIZE) {
+		arr->kmalloced = true;
+		arr->chunks[0] = kmprof_kmalloc_node(nr_objs *
+						     sizeof(struct test),
+						     gfp, node);
+		if (!arr->chunks[0])
+			goto err;
+		return arr;
+	}
+
+	for (i = 0; i < nr_chunks; i++) {
+		page = alloc_pages_node(node, gfp, NUMA_CHUNK_ORDER);
+		if (!page)
+			goto err;
+		arr->chunks[i] = page_address(page);
+	}
+	return arr;
+
+err:
+	numa_array_free(arr);
+	return NULL;
+}
+
+static void numa_obj_swap(void *data, unsigned long i, unsigned long j)
+{
+	struct numa_array *arr = data;
+
+	swap(numa_obj(arr, i)->second, numa_obj(arr, j)->second);
+}
+
+/*
+ * Link every object in a single random cycle through its 'second' field,
+ * defeating the hardware prefetchers on the chase.
+ */
+static void numa_array_link(struct numa_array *arr)
+{
+	unsigned long i;
+
+	for (i = 0; i < arr->nr_objs; i++) {
+		numa_obj(arr, i)->first = i;
+		numa_obj(arr, i)->second = i;
+	}
+	bench_sattolo(arr->nr_objs, numa_obj_swap, arr);
+}
+
+static int numa_thread(struct bench_thread *bt)
+{
+	struct numa_job *job = bt->run->data;
+	struct numa_array *arr = job->arr;
+	unsigned long i, idx;
+	unsigned int p;
+	u64 start, sum = 0;
+
+	start = ktime_get_ns();
+	for (p = 0; p < numa_passes; p++) {
+		for (i = 0; i < arr->nr_objs; i++) {
+			sum += numa_obj(arr, i)->first;
+			if (!(i & 0xffff))
+				cond_resched();
+		}
+	}
+	job->read_ns = ktime_get_ns() - start;
+
+	start = ktime_get_ns();
+	for (p = 0; p < numa_passes; p++) {
+		for (i = 0; i < arr->nr_objs; i++) {
+			numa_obj(arr, i)->first = i + p;
+			if (!(i & 0xffff))
+				cond_resched();
+		}
+	}
+	job->write_ns = ktime_get_ns() - start;
+
+	/* Every load depends on the previous one: pure memory latency */
+	idx = 0;
+	start = ktime_get_ns();
+	for (i = 0; i < arr->nr_objs; i++) {
+		idx = numa_obj(arr, idx)->second;
+		if (!(i & 0xffff))
+			cond_resched();
+	}
+	job->chase_ns = ktime_get_ns() - start;
+
+	WRITE_ONCE(numa_sink, sum + idx);
+	bt->ops = arr->nr_objs;
+	bt->ns = job->read_ns + job->write_ns + job->chase_ns;
+	return 0;
+}
+
+static int numa_measure(int cpu_node, struct numa_array *arr)
+{
+	struct numa_job job = { .arr = arr };
+	struct bench_run *run;
+	u64 bytes;
+	int cpu, err;
+
+	cpu = cpumask_first_and(cpumask_of_node(cpu_node), cpu_online_mask);
+	if (cpu >= nr_cpu_ids)
+		return 0;
+
+	run = bench_run_alloc("my-alloc-numa", cpumask_of(cpu), 1);
+	if (IS_ERR(run))
+		return PTR_ERR(run);
+
+	err = bench_run_exec(run, numa_thread, &job);
+	bench_run_free(run);
+	if (err)
+		return err;
+
+	/* bytes/ns = GB/s */
+	bytes = (u64)arr->nr_objs * sizeof(struct test) * numa_passes;
+	PR_DEBUG("cpu node %d (cpu %d) -> mem node %d: read " BENCH_FP_FMT
+		 " GB/s, write " BENCH_FP_FMT " GB/s, chase " BENCH_FP_FMT
+		 " ns/access\n", cpu_node, cpu, arr->node,
+		 BENCH_FP_ARG(bench_ns_per_op(bytes, job.read_ns)),
+		 BENCH_FP_ARG(bench_ns_per_op(bytes, job.write_ns)),
+		 BENCH_FP_ARG(bench_ns_per_op(job.chase_ns, arr->nr_objs)));
+	return 0;
+}
+
+int my_alloc_numa_run(void)
+{
+	struct numa_array **arrays;
+	int node, cpu_node, err = 0;
+
+	if (numa_objs < 2 || numa_objs > U32_MAX || !numa_passes)
+		return -EINVAL;
+
+	arrays = kmprof_kcalloc(nr_node_ids, sizeof(*arrays), GFP_KERNEL);
+	if (!arrays)
+		return -ENOMEM;
+
+	for_each_node_state(node, N_MEMORY) {
+		arrays[node] = numa_array_alloc(node, numa_objs);
+		if (!arrays[node]) {
+			PR_ERROR("failed to allocate %lu objects on node %d\n",
+				 numa_objs, node);
+			err = -ENOMEM;
+			goto out;
+		}
+		numa_array_link(arrays[node]);
+	}
+
+	PR_DEBUG("%lu objects (%lu KiB) per node, %u passes\n", numa_objs,
+		 (numa_objs * sizeof(struct test)) >> 10, numa_passes);
+	for_each_node_state(cpu_node, N_CPU) {
+		for_each_node_state(node, N_MEMORY) {
+			err = numa_measure(cpu_node, arrays[node]);
+			if (err)
+				goto out;
+		}
+	}
+
+out:
+	for_each_node_state(node, N_MEMORY)
+		numa_array_free(arrays[node]);
+	kmprof_kfree(arrays);
+	return err;
+}
@@ -0,0 +1,296 @@
+/*
+ * Copyright (c) 2026 Bruno E. O. Meneguele <bmeneguele@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 2 as published by the
+ * Free Software Foundation.
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/mm.h>
+#include <linux/slab.h>
+#include <linux/xarray.h>
+#include <linux/rcupdate.h>
+#include <linux/percpu.h>
+#include <linux/log2.h>
+#include <linux/ktime.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+
+#include "utils.h"
+#include "my-alloc.h"
+#include "kmprof.h"
+
+#ifdef CONFIG_DEBUG_PAGE_REF
+#include <trace/events/page_ref.h>
+
+/*
+ * Page refcount tracer. Pages are explicitly watched by the allocation sites
+ * we care about with pgref_watch(), then the page_ref_* tracepoints report
+ * every get/put done to them. When the refcount of a watched page drops to
+ * zero its lifetime (watch to final put) and the peak refcount it reached are
+ * accounted in log2 histograms, exported as my-alloc/pgref in debugfs.
+ *
+ * The probes see every page refcount change in the system, so the filtering
+ * must be cheap: a lockless xarray lookup by pfn and per-CPU counters.
+ * Requires CONFIG_DEBUG_PAGE_REF, otherwise the tracepoints don't exist.
+ */
+
+#define PGREF_LIFETIME_BUCKETS	48
+#define PGREF_PEAK_BUCKETS	16
+
+struct pgref_entry {
+	u64 birth_ns;
+	atomic_t peak;
+	struct rcu_head rcu;
+};
+
+struct pgref_stats {
+	u64 events;
+	u64 deaths;
+	/* Bucket n holds values in [2^n, 2^(n+1)) */
+	u64 lifetime[PGREF_LIFETIME_BUCKETS];
+	u64 peak[PGREF_PEAK_BUCKETS];
+};
+
+static DEFINE_PER_CPU(struct pgref_stats, pgref_stats);
+
+/* Watched pages indexed by pfn. Entries are removed from tracepoint probes,
+ * which may run in interrupt context */
+static DEFINE_XARRAY_FLAGS(pgref_pages, XA_FLAGS_LOCK_IRQ);
+
+static bool pgref_active;
+
+static unsigned int pgref_bucket(u64 v, unsigned int nr)
+{
+	return v ? min_t(unsigned int, ilog2(v), nr - 1) : 0;
+}
+
+/* kfree_rcu() would bypass kmprof, the entry comes from kmprof_kmalloc() */
+static void pgref_entry_free_rcu(struct rcu_head *rcu)
+{
+	kmprof_kfree(container_of(rcu, struct pgref_entry, rcu));
+}
+
+static void pgref_update(struct page *page, bool may_die)
+{
+	unsigned long pfn = page_to_pfn(page);
+	struct pgref_entry *e;
+	unsigned long flags;
+	int count, peak;
+	u64 age;
+
+	rcu_read_lock();
+	e = xa_load(&pgref_pages, pfn);
+	if (likely(!e))
+		goto out;
+
+	this_cpu_inc(pgref_stats.events);
+	count = page_ref_count(page);
+	peak = atomic_read(&e->peak);
+	while (count > peak && !atomic_try_cmpxchg(&e->peak, &peak, count))
+		;
+
+	if (count || !may_die)
+		goto out;
+
+	/* The last reference is gone, the page goes back to the allocator */
+	xa_lock_irqsave(&pgref_pages, flags);
+	if (__xa_cmpxchg(&pgref_pages, pfn, e, NULL, 0) == e) {
+		age = ktime_get_ns() - e->birth_ns;
+		peak = atomic_read(&e->peak);
+		this_cpu_inc(pgref_stats.deaths);
+		this_cpu_inc(pgref_stats.lifetime[pgref_bucket(age,
+					PGREF_LIFETIME_BUCKETS)]);
+		this_cpu_inc(pgref_stats.peak[pgref_bucket(peak,
+					PGREF_PEAK_BUCKETS)]);
+		call_rcu(&e->rcu, pgref_entry_free_rcu);
+	}
+	xa_unlock_irqrestore(&pgref_pages, flags);
+out:
+	rcu_read_unlock();
+}
+
+static void pgref_probe_set(void *data, struct page *page, int v)
+{
+	pgref_update(page, true);
+}
+
+static void pgref_probe_mod(void *data, struct page *page, int v)
+{
+	pgref_update(page, true);
+}
+
+static void pgref_probe_mod_ret(void *data, struct page *page, int v,
+				int ret)
+{
+	pgref_update(page, true);
+}
+
+/* A frozen page has a zero refcount, yet it is still alive (i.e. being
+ * migrated), it just can't be grabbed meanwhile */
+static void pgref_probe_freeze(void *data, struct page *page, int v, int ret)
+{
+	pgref_update(page, false);
+}
+
+static void pgref_probe_unfreeze(void *data, struct page *page, int v)
+{
+	pgref_update(page, false);
+}
+
+int pgref_watch(struct page *page)
+{
+	struct pgref_entry *e;
+	int err;
+
+	if (!pgref_active)
+		return -ENODEV;
+
+	e = kmprof_kmalloc(sizeof(*e), GFP_KERNEL);
+	if (!e)
+		return -ENOMEM;
+	e->birth_ns = ktime_get_ns();
+	atomic_set(&e->peak, page_ref_count(page));
+
+	err = xa_insert_irq(&pgref_pages, page_to_pfn(page), e, GFP_KERNEL);
+	if (err)
+		kmprof_kfree(e);
+	/* Already watched is fine */
+	return err == -EBUSY ? 0 : err;
+}
+
+static int pgref_show(struct seq_file *m, void *v)
+{
+	struct pgref_stats sum = { };
+	struct pgref_stats *s;
+	struct pgref_entry *e;
+	unsigned long pfn, live = 0;
+	int cpu, i;
+
+	for_each_possible_cpu(cpu) {
+		s = per_cpu_ptr(&pgref_stats, cpu);
+		sum.events += s->events;
+		sum.deaths += s->deaths;
+		for (i = 0; i < PGREF_LIFETIME_BUCKETS; i++)
+			sum.lifetime[i] += s->lifetime[i];
+		for (i = 0; i < PGREF_PEAK_BUCKETS; i++)
+			sum.peak[i] += s->peak[i];
+	}
+
+	rcu_read_lock();
+	xa_for_each(&pgref_pages, pfn, e)
+		live++;
+	rcu_read_unlock();
+
+	seq_printf(m, "events %llu\nfreed %llu\nlive %lu\n", sum.events,
+		   sum.deaths, live);
+
+	seq_puts(m, "\nlifetime (ns)\n");
+	for (i = 0; i < PGREF_LIFETIME_BUCKETS; i++)
+		if (sum.lifetime[i])
+			seq_printf(m, "[%llu, %llu) %llu\n", 1ULL << i,
+				   2ULL << i, sum.lifetime[i]);
+
+	seq_puts(m, "\npeak refcount\n");
+	for (i = 0; i < PGREF_PEAK_BUCKETS; i++)
+		if (sum.peak[i])
+			seq_printf(m, "[%u, %u) %llu\n", 1U << i, 2U << i,
+				   sum.peak[i]);
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(pgref);
+
+int pgref_trace_start(void)
+{
+	int err;
+
+	err = register_trace_page_ref_set(pgref_probe_set, NULL);
+	if (err)
+		return err;
+	err = register_trace_page_ref_mod(pgref_probe_mod, NULL);
+	if (err)
+		goto err_set;
+	err = register_trace_page_ref_mod_and_test(pgref_probe_mod_ret, NULL);
+	if (err)
+		goto err_mod;
+	err = register_trace_page_ref_mod_and_return(pgref_probe_mod_ret,
+						     NULL);
+	if (err)
+		goto err_mod_and_test;
+	err = register_trace_page_ref_mod_unless(pgref_probe_mod_ret, NULL);
+	if (err)
+		goto err_mod_and_return;
+	err = register_trace_page_ref_freeze(pgref_probe_freeze, NULL);
+	if (err)
+		goto err_mod_unless;
+	err = register_trace_page_ref_unfreeze(pgref_probe_unfreeze, NULL);
+	if (err)
+		goto err_freeze;
+
+	debugfs_create_file("pgref", 0444, my_alloc_debugfs, NULL,
+			    &pgref_fops);
+	pgref_active = true;
+	return 0;
+
+err_freeze:
+	unregister_trace_page_ref_freeze(pgref_probe_freeze, NULL);
+err_mod_unless:
+	unregister_trace_page_ref_mod_unless(pgref_probe_mod_ret, NULL);
+err_mod_and_return:
+	unregister_trace_page_ref_mod_and_return(pgref_probe_mod_ret, NULL);
+err_mod_and_test:
+	unregister_trace_page_ref_mod_and_test(pgref_probe_mod_ret, NULL);
+err_mod:
+	unregister_trace_page_ref_mod(pgref_probe_mod, NULL);
+err_set:
+	unregister_trace_page_ref_set(pgref_probe_set, NULL);
+	tracepoint_synchronize_unregister();
+	return err;
+}
+
+void pgref_trace_stop(void)
+{
+	struct pgref_entry *e;
+	unsigned long pfn;
+
+	if (!pgref_active)
+		return;
+	pgref_active = false;
+
+	unregister_trace_page_ref_unfreeze(pgref_probe_unfreeze, NULL);
+	unregister_trace_page_ref_freeze(pgref_probe_freeze, NULL);
+	unregister_trace_page_ref_mod_unless(pgref_probe_mod_ret, NULL);
+	unregister_trace_page_ref_mod_and_return(pgref_probe_mod_ret, NULL);
+	unregister_trace_page_ref_mod_and_test(pgref_probe_mod_ret, NULL);
+	unregister_trace_page_ref_mod(pgref_probe_mod, NULL);
+	unregister_trace_page_ref_set(pgref_probe_set, NULL);
+	/* No probe is running past this point */
+	tracepoint_synchronize_unregister();
+	/* Nor any pgref_entry_free_rcu(), the module text may go away */
+	rcu_barrier();
+
+	xa_for_each(&pgref_pages, pfn, e)
+		kmprof_kfree(e);
+	xa_destroy(&pgref_pages);
+}
+
+#else /* !CONFIG_DEBUG_PAGE_REF */
+
+int pgref_watch(struct page *page)
+{
+	return -EOPNOTSUPP;
+}
+
+int pgref_trace_start(void)
+{
+	PR_ERROR("page refcount tracing needs CONFIG_DEBUG_PAGE_REF\n");
+	return -EOPNOTSUPP;
+}
+
+void pgref_trace_stop(void)
+{
+}
+
+#endif /* CONFIG_DEBUG_PAGE_REF */
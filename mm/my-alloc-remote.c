@@ -0,0 +1,308 @@
+/*
+ * Copyright (c) 2026 Bruno E. O. Meneguele <bmeneguele@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 2 as published by the
+ * Free Software Foundation.
+ */
+
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/cpumask.h>
+#include <linux/cache.h>
+#include <asm/barrier.h>
+#include <asm/processor.h>
+
+#include "utils.h"
+#include "bench.h"
+#include "my-alloc.h"
+#include "kmprof.h"
+
+/*
+ * Remote free mode: a producer kthread allocates objects on one CPU and hands
+ * them over a single producer/single consumer ring to a consumer kthread on
+ * another CPU, which frees them. SLUB frees of objects belonging to another
+ * CPU's slab can't use the lockless per-CPU freelist and the producer keeps
+ * refilling from partial/new slabs, both costs are measured here against a
+ * single CPU allocating and freeing its own objects.
+ *
+ * Example:
+ * insmod my-alloc.ko mode=remote remote_producer=0 remote_consumer=8
+ */
+static unsigned int remote_producer;
+module_param(remote_producer, uint, 0444);
+MODULE_PARM_DESC(remote_producer, "CPU allocating the objects");
+
+static int remote_consumer = -1;
+module_param(remote_consumer, int, 0444);
+MODULE_PARM_DESC(remote_consumer,
+		 "CPU freeing the objects (-1 = next online CPU)");
+
+static unsigned int remote_objs = 1000000;
+module_param(remote_objs, uint, 0444);
+MODULE_PARM_DESC(remote_objs, "Objects passed from producer to consumer");
+
+/* Objects moved in and out of the ring at once */
+#define REMOTE_BATCH		64
+#define REMOTE_RING_SIZE	4096
+
+/*
+ * head is only written by the producer and tail by the consumer, each in its
+ * own cacheline so they don't bounce between the two CPUs more than needed.
+ */
+struct remote_ring {
+	unsigned long head ____cacheline_aligned_in_smp;
+	unsigned long tail ____cacheline_aligned_in_smp;
+	void *slots[REMOTE_RING_SIZE] ____cacheline_aligned_in_smp;
+};
+
+struct remote_ctx {
+	struct remote_ring *ring;
+	bool cache;
+	unsigned int producer;
+	/* Objects freed, short of remote_objs when an allocation failed */
+	unsigned int done;
+	/* Time spent only in the allocator calls */
+	u64 alloc_ns;
+	u64 free_ns;
+};
+
+static __always_inline void *remote_alloc(struct remote_ctx *ctx)
+{
+	if (ctx->cache)
+		return kmem_cache_alloc(test_cache, GFP_KERNEL);
+	return kmalloc(sizeof(struct test), GFP_KERNEL);
+}
+
+static __always_inline void remote_free(struct remote_ctx *ctx, void *obj)
+{
+	if (ctx->cache)
+		kmem_cache_free(test_cache, obj);
+	else
+		kfree(obj);
+}
+
+static void remote_ring_push(struct remote_ring *ring, void **objs,
+			     unsigned int nr)
+{
+	unsigned long head = ring->head;
+	unsigned int i;
+
+	while (head - smp_load_acquire(&ring->tail) > REMOTE_RING_SIZE - nr)
+		cpu_relax();
+
+	for (i = 0; i < nr; i++)
+		ring->slots[(head + i) % REMOTE_RING_SIZE] = objs[i];
+	smp_store_release(&ring->head, head + nr);
+}
+
+static unsigned int remote_ring_pop(struct remote_ring *ring, void **objs,
+				    unsigned int max)
+{
+	unsigned long tail = ring->tail;
+	unsigned long avail;
+	unsigned int i, nr;
+
+	while (!(avail = smp_load_acquire(&ring->head) - tail))
+		cpu_relax();
+
+	nr = min_t(unsigned long, avail, max);
+	for (i = 0; i < nr; i++)
+		objs[i] = ring->slots[(tail + i) % REMOTE_RING_SIZE];
+	smp_store_release(&ring->tail, tail + nr);
+	return nr;
+}
+
+static int remote_producer_thread(struct remote_ctx *ctx,
+				  struct bench_thread *bt)
+{
+	void *objs[REMOTE_BATCH], *end = NULL;
+	unsigned int i, nr, left = remote_objs;
+	u64 start;
+
+	while (left) {
+		nr = min_t(unsigned int, left, REMOTE_BATCH);
+		start = ktime_get_ns();
+		for (i = 0; i < nr; i++) {
+			objs[i] = remote_alloc(ctx);
+			if (unlikely(!objs[i]))
+				break;
+		}
+		ctx->alloc_ns += ktime_get_ns() - start;
+		remote_ring_push(ctx->ring, objs, i);
+		bt->ops += i;
+		if (unlikely(i < nr)) {
+			/* The consumer waits for remote_objs objects or a
+			 * NULL, whatever comes first */
+			remote_ring_push(ctx->ring, &end, 1);
+			return -ENOMEM;
+		}
+		left -= nr;
+		cond_resched();
+	}
+	return 0;
+}
+
+static int remote_consumer_thread(struct remote_ctx *ctx,
+				  struct bench_thread *bt)
+{
+	void *objs[REMOTE_BATCH];
+	unsigned int i, nr, left = remote_objs;
+	u64 start;
+
+	while (left) {
+		nr = remote_ring_pop(ctx->ring, objs, REMOTE_BATCH);
+		start = ktime_get_ns();
+		for (i = 0; i < nr && objs[i]; i++)
+			remote_free(ctx, objs[i]);
+		ctx->free_ns += ktime_get_ns() - start;
+		ctx->done += i;
+		bt->ops += i;
+		/* The producer failed to allocate, nothing else is coming */
+		if (i < nr)
+			break;
+		left -= nr;
+		cond_resched();
+	}
+	return 0;
+}
+
+static int remote_thread(struct bench_thread *bt)
+{
+	struct remote_ctx *ctx = bt->run->data;
+	u64 start = ktime_get_ns();
+	int err;
+
+	if (bt->cpu == ctx->producer)
+		err = remote_producer_thread(ctx, bt);
+	else
+		err = remote_consumer_thread(ctx, bt);
+	bt->ns = ktime_get_ns() - start;
+	return err;
+}
+
+/* Baseline: the same batches allocated and freed by a single CPU */
+static int remote_local_thread(struct bench_thread *bt)
+{
+	struct remote_ctx *ctx = bt->run->data;
+	void *objs[REMOTE_BATCH];
+	unsigned int i, nr, left = remote_objs;
+	u64 start, t0 = ktime_get_ns();
+
+	while (left) {
+		nr = min_t(unsigned int, left, REMOTE_BATCH);
+		start = ktime_get_ns();
+		for (i = 0; i < nr; i++) {
+			objs[i] = remote_alloc(ctx);
+			if (unlikely(!objs[i])) {
+				while (i--)
+					remote_free(ctx, objs[i]);
+				bt->ns = ktime_get_ns() - t0;
+				return -ENOMEM;
+			}
+		}
+		ctx->alloc_ns += ktime_get_ns() - start;
+
+		start = ktime_get_ns();
+		for (i = 0; i < nr; i++)
+			remote_free(ctx, objs[i]);
+		ctx->free_ns += ktime_get_ns() - start;
+
+		ctx->done += nr;
+		left -= nr;
+		bt->ops += nr;
+		cond_resched();
+	}
+	bt->ns = ktime_get_ns() - t0;
+	return 0;
+}
+
+static int remote_measure(struct remote_ctx *ctx, const struct cpumask *cpus,
+			  bench_fn_t fn, const char *what)
+{
+	struct bench_run *run;
+	int err;
+
+	ctx->alloc_ns = 0;
+	ctx->free_ns = 0;
+	ctx->done = 0;
+	run = bench_run_alloc("my-alloc-remote", cpus, 0);
+	if (IS_ERR(run))
+		return PTR_ERR(run);
+
+	err = bench_run_exec(run, fn, ctx);
+	if (err && run->wall_ns)
+		PR_ERROR("%s %s: allocation failed after %u objects\n",
+			 ctx->cache ? "test_cache" : "kmalloc", what,
+			 ctx->done);
+	if (ctx->done)
+		PR_DEBUG("%-10s %-6s alloc " BENCH_FP_FMT " ns/op, free "
+			 BENCH_FP_FMT " ns/op, " BENCH_FP_FMT " Mobjs/s\n",
+			 ctx->cache ? "test_cache" : "kmalloc", what,
+			 BENCH_FP_ARG(bench_ns_per_op(ctx->alloc_ns,
+						      ctx->done)),
+			 BENCH_FP_ARG(bench_ns_per_op(ctx->free_ns,
+						      ctx->done)),
+			 BENCH_FP_ARG(bench_mops(run->wall_ns, ctx->done)));
+
+	bench_run_free(run);
+	return err;
+}
+
+int my_alloc_remote_run(void)
+{
+	struct remote_ctx ctx = { };
+	cpumask_var_t cpus;
+	unsigned int consumer;
+	int err = 0, i;
+
+	if (!remote_objs || remote_producer >= nr_cpu_ids ||
+	    !cpu_online(remote_producer))
+		return -EINVAL;
+
+	if (remote_consumer < 0) {
+		consumer = cpumask_next(remote_producer, cpu_online_mask);
+		if (consumer >= nr_cpu_ids)
+			consumer = cpumask_first(cpu_online_mask);
+	} else {
+		consumer = remote_consumer;
+	}
+	if (consumer >= nr_cpu_ids || consumer == remote_producer ||
+	    !cpu_online(consumer)) {
+		PR_ERROR("need two different online CPUs\n");
+		return -EINVAL;
+	}
+
+	if (!zalloc_cpumask_var(&cpus, GFP_KERNEL))
+		return -ENOMEM;
+	ctx.ring = kmprof_kzalloc(sizeof(*ctx.ring), GFP_KERNEL);
+	if (!ctx.ring) {
+		err = -ENOMEM;
+		goto out;
+	}
+	ctx.producer = remote_producer;
+
+	PR_DEBUG("%u objects, producer cpu %u, consumer cpu %u\n", remote_objs,
+		 remote_producer, consumer);
+	for (i = 0; i < 2 && !err; i++) {
+		ctx.cache = i;
+
+		cpumask_clear(cpus);
+		cpumask_set_cpu(remote_producer, cpus);
+		err = remote_measure(&ctx, cpus, remote_local_thread, "local");
+		if (err)
+			break;
+
+		ctx.ring->head = 0;
+		ctx.ring->tail = 0;
+		cpumask_set_cpu(consumer, cpus);
+		err = remote_measure(&ctx, cpus, remote_thread, "remote");
+	}
+
+	kmprof_kfree(ctx.ring);
+out:
+	free_cpumask_var(cpus);
+	return err;
+}
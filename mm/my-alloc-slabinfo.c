@@ -0,0 +1,259 @@
+/*
+ * Copyright (c) 2026 Bruno E. O. Meneguele <bmeneguele@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 2 as published by the
+ * Free Software Foundation.
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/fs.h>
+#include <linux/string.h>
+#include <linux/mutex.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+
+#include "my-alloc.h"
+#include "kmprof.h"
+
+/*
+ * Occupancy and fragmentation of the caches created by this module, exported
+ * as my-alloc/slabinfo in debugfs.
+ *
+ * struct slab and struct kmem_cache are private to mm/, a module can't walk
+ * the slabs of a cache. What SLUB does export is the per cache directory in
+ * /sys/kernel/slab/, so every read of the file collects those counters (a few
+ * small sysfs reads per cache, cheap enough to be polled every second) and
+ * adds what only we know: the bytes of each object actually used by payload.
+ * Counters that the kernel doesn't provide, i.e. objects, total_objects and
+ * slabs without CONFIG_SLUB_DEBUG, are shown as n/a.
+ */
+
+#define SLABINFO_MAX_CACHES	8
+
+struct slabinfo_cache {
+	struct kmem_cache *cache;
+	const char *name;
+	/* Bytes of the object the user really cares about */
+	size_t payload;
+};
+
+static struct slabinfo_cache slabinfo_caches[SLABINFO_MAX_CACHES];
+static unsigned int slabinfo_nr;
+static DEFINE_MUTEX(slabinfo_lock);
+
+enum slabinfo_attr {
+	SLABINFO_OBJECT_SIZE,
+	SLABINFO_SLAB_SIZE,
+	SLABINFO_OBJS_PER_SLAB,
+	SLABINFO_ORDER,
+	SLABINFO_SLABS,
+	SLABINFO_PARTIAL,
+	SLABINFO_CPU_SLABS,
+	SLABINFO_OBJECTS,
+	SLABINFO_TOTAL_OBJECTS,
+	SLABINFO_OBJECTS_PARTIAL,
+	SLABINFO_NR_ATTRS,
+};
+
+static const char * const slabinfo_attr_names[] = {
+	[SLABINFO_OBJECT_SIZE]		= "object_size",
+	[SLABINFO_SLAB_SIZE]		= "slab_size",
+	[SLABINFO_OBJS_PER_SLAB]	= "objs_per_slab",
+	[SLABINFO_ORDER]		= "order",
+	[SLABINFO_SLABS]		= "slabs",
+	[SLABINFO_PARTIAL]		= "partial",
+	[SLABINFO_CPU_SLABS]		= "cpu_slabs",
+	[SLABINFO_OBJECTS]		= "objects",
+	[SLABINFO_TOTAL_OBJECTS]	= "total_objects",
+	[SLABINFO_OBJECTS_PARTIAL]	= "objects_partial",
+};
+
+/* Read /sys/kernel/slab/<cache>/<attr> into 'buf', NUL terminated */
+static int slabinfo_read(const char *cache, const char *attr, char *buf,
+			 size_t size)
+{
+	struct file *f;
+	loff_t pos = 0;
+	ssize_t len;
+
+	snprintf(buf, size, "/sys/kernel/slab/%s/%s", cache, attr);
+	f = filp_open(buf, O_RDONLY, 0);
+	if (IS_ERR(f))
+		return PTR_ERR(f);
+	len = kernel_read(f, buf, size - 1, &pos);
+	filp_close(f, NULL);
+	if (len < 0)
+		return len;
+	buf[len] = '\0';
+	return 0;
+}
+
+/* Every counter file starts with the total, per node values may follow */
+static bool slabinfo_read_ulong(const char *cache, enum slabinfo_attr attr,
+				unsigned long *val)
+{
+	char buf[128];
+
+	if (slabinfo_read(cache, slabinfo_attr_names[attr], buf, sizeof(buf)))
+		return false;
+	return sscanf(buf, "%lu", val) == 1;
+}
+
+static void slabinfo_show_ratio(struct seq_file *m, const char *what,
+				unsigned long num, unsigned long den)
+{
+	u64 r = den ? div64_u64((u64)num * 1000, den) : 0;
+
+	seq_printf(m, "%-22s %llu.%01llu%%\n", what, div_u64(r, 10),
+		   r - div_u64(r, 10) * 10);
+}
+
+/*
+ * SLUB prints "objects(slabs) C<cpu>=objects(slabs) ...", the objects being
+ * an estimate, so only the slab counts are shown.
+ */
+static void slabinfo_show_cpu_partial(struct seq_file *m, const char *cache)
+{
+	unsigned int cpu, slabs;
+	char *buf, *s, *tok;
+	int objs;
+
+	/* One entry per online CPU, it doesn't fit the stack */
+	buf = kmprof_kmalloc(PAGE_SIZE, GFP_KERNEL);
+	if (!buf || slabinfo_read(cache, "slabs_cpu_partial", buf, PAGE_SIZE)) {
+		seq_puts(m, "cpu_partial_slabs      n/a\n");
+		kmprof_kfree(buf);
+		return;
+	}
+
+	seq_puts(m, "cpu_partial_slabs     ");
+	s = buf;
+	while ((tok = strsep(&s, " \n"))) {
+		if (sscanf(tok, "C%u=%d(%u)", &cpu, &objs, &slabs) == 3)
+			seq_printf(m, " cpu%u=%u", cpu, slabs);
+	}
+	seq_putc(m, '\n');
+	kmprof_kfree(buf);
+}
+
+static void slabinfo_show_cache(struct seq_file *m, struct slabinfo_cache *c)
+{
+	unsigned long v[SLABINFO_NR_ATTRS], slab_bytes, tail, pad;
+	bool ok[SLABINFO_NR_ATTRS];
+	int i;
+
+	for (i = 0; i < SLABINFO_NR_ATTRS; i++)
+		ok[i] = slabinfo_read_ulong(c->name, i, &v[i]);
+
+	seq_printf(m, "%s\n", c->name);
+	seq_printf(m, "%-22s %zu\n", "payload", c->payload);
+	for (i = 0; i < SLABINFO_NR_ATTRS; i++) {
+		if (ok[i])
+			seq_printf(m, "%-22s %lu\n", slabinfo_attr_names[i],
+				   v[i]);
+		else
+			seq_printf(m, "%-22s n/a\n", slabinfo_attr_names[i]);
+	}
+
+	/* Without the layout nothing else can be derived */
+	if (!ok[SLABINFO_SLAB_SIZE] || !ok[SLABINFO_OBJS_PER_SLAB] ||
+	    !ok[SLABINFO_ORDER] || !ok[SLABINFO_OBJECT_SIZE])
+		goto out;
+
+	/*
+	 * Each slot is slab_size bytes: payload, then the padding added to
+	 * the structure by the compiler (object_size - payload), then the one
+	 * added by the cache alignment and SLUB metadata (slab_size -
+	 * object_size). What is left at the end of the slab fits no object.
+	 */
+	slab_bytes = PAGE_SIZE << v[SLABINFO_ORDER];
+	tail = slab_bytes - v[SLABINFO_OBJS_PER_SLAB] * v[SLABINFO_SLAB_SIZE];
+	pad = v[SLABINFO_SLAB_SIZE] - min_t(unsigned long, c->payload,
+					    v[SLABINFO_SLAB_SIZE]);
+	seq_printf(m, "%-22s %lu (struct %lu, align/meta %lu)\n",
+		   "waste_per_object", pad,
+		   v[SLABINFO_OBJECT_SIZE] - min_t(unsigned long, c->payload,
+						   v[SLABINFO_OBJECT_SIZE]),
+		   v[SLABINFO_SLAB_SIZE] - v[SLABINFO_OBJECT_SIZE]);
+	seq_printf(m, "%-22s %lu\n", "waste_per_slab_tail", tail);
+
+	if (ok[SLABINFO_SLABS] && ok[SLABINFO_TOTAL_OBJECTS] &&
+	    ok[SLABINFO_OBJECTS]) {
+		seq_printf(m, "%-22s %lu\n", "wasted_bytes_in_use",
+			   v[SLABINFO_OBJECTS] * pad);
+		seq_printf(m, "%-22s %lu\n", "wasted_bytes_tails",
+			   v[SLABINFO_SLABS] * tail);
+		seq_printf(m, "%-22s %lu\n", "free_slot_bytes",
+			   (v[SLABINFO_TOTAL_OBJECTS] - v[SLABINFO_OBJECTS]) *
+			   v[SLABINFO_SLAB_SIZE]);
+		slabinfo_show_ratio(m, "occupancy", v[SLABINFO_OBJECTS],
+				    v[SLABINFO_TOTAL_OBJECTS]);
+		slabinfo_show_ratio(m, "payload_efficiency",
+				    v[SLABINFO_OBJECTS] * c->payload,
+				    v[SLABINFO_SLABS] * slab_bytes);
+	}
+	if (ok[SLABINFO_PARTIAL] && ok[SLABINFO_OBJECTS_PARTIAL])
+		slabinfo_show_ratio(m, "partial_occupancy",
+				    v[SLABINFO_OBJECTS_PARTIAL],
+				    v[SLABINFO_PARTIAL] *
+				    v[SLABINFO_OBJS_PER_SLAB]);
+out:
+	slabinfo_show_cpu_partial(m, c->name);
+}
+
+static int slabinfo_show(struct seq_file *m, void *v)
+{
+	unsigned int i;
+
+	mutex_lock(&slabinfo_lock);
+	for (i = 0; i < slabinfo_nr; i++) {
+		if (i)
+			seq_putc(m, '\n');
+		slabinfo_show_cache(m, &slabinfo_caches[i]);
+	}
+	mutex_unlock(&slabinfo_lock);
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(slabinfo);
+
+/* 'name' must be the one given to kmem_cache_create() and stay valid */
+int slabinfo_add(struct kmem_cache *cache, const char *name, size_t payload)
+{
+	int err = 0;
+
+	mutex_lock(&slabinfo_lock);
+	if (slabinfo_nr < SLABINFO_MAX_CACHES) {
+		slabinfo_caches[slabinfo_nr].cache = cache;
+		slabinfo_caches[slabinfo_nr].name = name;
+		slabinfo_caches[slabinfo_nr].payload = payload;
+		slabinfo_nr++;
+	} else {
+		err = -ENOSPC;
+	}
+	mutex_unlock(&slabinfo_lock);
+	return err;
+}
+
+/* Must be called before the cache is destroyed */
+void slabinfo_del(struct kmem_cache *cache)
+{
+	unsigned int i;
+
+	mutex_lock(&slabinfo_lock);
+	for (i = 0; i < slabinfo_nr; i++) {
+		if (slabinfo_caches[i].cache != cache)
+			continue;
+		slabinfo_caches[i] = slabinfo_caches[--slabinfo_nr];
+		break;
+	}
+	mutex_unlock(&slabinfo_lock);
+}
+
+void slabinfo_debugfs_init(void)
+{
+	debugfs_create_file("slabinfo", 0444, my_alloc_debugfs, NULL,
+			    &slabinfo_fops);
+}
@@ -0,0 +1,236 @@
+/*
+ * Copyright (c) 2026 Bruno E. O. Meneguele <bmeneguele@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 2 as published by the
+ * Free Software Foundation.
+ */
+
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/cpumask.h>
+#include <linux/random.h>
+
+#include "utils.h"
+#include "bench.h"
+#include "my-alloc.h"
+#include "kmprof.h"
+
+/*
+ * Stress mode: one kthread bound to each of the first 'stress_threads' online
+ * CPUs allocates 'stress_batch' objects and frees them back in the chosen
+ * order, over and over for 'stress_ms'. Runs are time bound, so a CPU being
+ * starved by the others shows up as a lower operation count.
+ *
+ * With stress_threads=0 the run is repeated for 1, 2, 4, ... threads up to
+ * every online CPU, showing where the allocator throughput flattens. Example:
+ * insmod my-alloc.ko mode=stress stress_pattern=random stress_batch=256
+ */
+static unsigned int stress_threads;
+module_param(stress_threads, uint, 0444);
+MODULE_PARM_DESC(stress_threads, "Threads, one per CPU (0 = scale 1..N)");
+
+static unsigned int stress_size = sizeof(struct test);
+module_param(stress_size, uint, 0444);
+MODULE_PARM_DESC(stress_size, "kmalloc object size in bytes");
+
+static bool stress_cache;
+module_param(stress_cache, bool, 0444);
+MODULE_PARM_DESC(stress_cache, "Use test_cache instead of kmalloc");
+
+static unsigned int stress_batch = 64;
+module_param(stress_batch, uint, 0444);
+MODULE_PARM_DESC(stress_batch, "Objects allocated before freeing them");
+
+static char *stress_pattern = "lifo";
+module_param(stress_pattern, charp, 0444);
+MODULE_PARM_DESC(stress_pattern, "Free order: lifo, fifo or random");
+
+static unsigned int stress_ms = 1000;
+module_param(stress_ms, uint, 0444);
+MODULE_PARM_DESC(stress_ms, "Duration of each run in milliseconds");
+
+#define STRESS_MAX_BATCH	65536
+
+enum stress_pattern {
+	STRESS_LIFO,
+	STRESS_FIFO,
+	STRESS_RANDOM,
+};
+
+static const char * const stress_pattern_names[] = {
+	[STRESS_LIFO]	= "lifo",
+	[STRESS_FIFO]	= "fifo",
+	[STRESS_RANDOM]	= "random",
+};
+
+static __always_inline void *stress_alloc(void)
+{
+	if (stress_cache)
+		return kmem_cache_alloc(test_cache, GFP_KERNEL);
+	return kmalloc(stress_size, GFP_KERNEL);
+}
+
+static __always_inline void stress_free(void *obj)
+{
+	if (stress_cache)
+		kmem_cache_free(test_cache, obj);
+	else
+		kfree(obj);
+}
+
+/* Free order for a batch, indexes into the objects array */
+static void stress_order_init(u32 *order, enum stress_pattern pattern)
+{
+	u32 i, j;
+
+	for (i = 0; i < stress_batch; i++) {
+		if (pattern == STRESS_LIFO)
+			order[i] = stress_batch - 1 - i;
+		else
+			order[i] = i;
+	}
+
+	if (pattern != STRESS_RANDOM)
+		return;
+
+	/* Fisher-Yates shuffle */
+	for (i = stress_batch - 1; i > 0; i--) {
+		j = get_random_u32_below(i + 1);
+		swap(order[i], order[j]);
+	}
+}
+
+static int stress_thread(struct bench_thread *bt)
+{
+	enum stress_pattern pattern = (uintptr_t)bt->run->data;
+	u64 start, deadline, now;
+	unsigned int i;
+	void **objs;
+	u32 *order;
+	int err = 0;
+
+	objs = kmprof_kmalloc_array(stress_batch, sizeof(*objs), GFP_KERNEL);
+	order = kmprof_kmalloc_array(stress_batch, sizeof(*order), GFP_KERNEL);
+	if (!objs || !order) {
+		err = -ENOMEM;
+		goto out;
+	}
+	stress_order_init(order, pattern);
+
+	start = ktime_get_ns();
+	deadline = start + (u64)stress_ms * NSEC_PER_MSEC;
+	/* The first batch may fail before any time is taken */
+	now = start;
+	do {
+		for (i = 0; i < stress_batch; i++) {
+			objs[i] = stress_alloc();
+			if (unlikely(!objs[i])) {
+				err = -ENOMEM;
+				break;
+			}
+		}
+		if (unlikely(err)) {
+			while (i--)
+				stress_free(objs[i]);
+			break;
+		}
+		for (i = 0; i < stress_batch; i++)
+			stress_free(objs[order[i]]);
+
+		bt->ops += stress_batch;
+		cond_resched();
+		now = ktime_get_ns();
+	} while (now < deadline);
+	bt->ns = now - start;
+
+out:
+	kmprof_kfree(order);
+	kmprof_kfree(objs);
+	return err;
+}
+
+/*
+ * Jain's fairness index over the per-thread throughput, scaled by 100:
+ * (sum x)^2 / (n * sum x^2). 100 means every CPU got the same share.
+ */
+static u64 stress_fairness(struct bench_run *run)
+{
+	u64 x, sum = 0, sum_sq = 0;
+	unsigned int i;
+
+	for (i = 0; i < run->nr_threads; i++) {
+		/* kops/s keeps the squares far from overflowing */
+		x = div64_u64(run->threads[i].ops * USEC_PER_SEC,
+			      max_t(u64, run->threads[i].ns, 1));
+		sum += x;
+		sum_sq += x * x;
+	}
+	if (!sum_sq)
+		return 0;
+	return div64_u64(sum * sum * 100, run->nr_threads * sum_sq);
+}
+
+static int stress_run_threads(unsigned int nr, enum stress_pattern pattern)
+{
+	struct bench_run *run;
+	struct bench_thread *bt;
+	unsigned int i;
+	int err;
+
+	run = bench_run_alloc("my-alloc-stress", cpu_online_mask, nr);
+	if (IS_ERR(run))
+		return PTR_ERR(run);
+
+	err = bench_run_exec(run, stress_thread, (void *)(uintptr_t)pattern);
+	if (err)
+		goto out;
+
+	bench_run_report(run, stress_pattern_names[pattern]);
+	for (i = 0; i < run->nr_threads; i++) {
+		bt = &run->threads[i];
+		PR_DEBUG("  cpu %u: %llu ops, " BENCH_FP_FMT " Mops/s\n",
+			 bt->cpu, bt->ops,
+			 BENCH_FP_ARG(bench_mops(bt->ns, bt->ops)));
+	}
+	PR_DEBUG("  fairness " BENCH_FP_FMT "%%\n",
+		 BENCH_FP_ARG(stress_fairness(run) * 100));
+out:
+	bench_run_free(run);
+	return err;
+}
+
+int my_alloc_stress_run(void)
+{
+	unsigned int nr, max_nr = num_online_cpus();
+	int pattern, err = 0;
+
+	pattern = match_string(stress_pattern_names,
+			       ARRAY_SIZE(stress_pattern_names),
+			       stress_pattern);
+	if (pattern < 0) {
+		PR_ERROR("unknown pattern: %s\n", stress_pattern);
+		return -EINVAL;
+	}
+	if (!stress_batch || stress_batch > STRESS_MAX_BATCH ||
+	    !stress_size || !stress_ms)
+		return -EINVAL;
+
+	PR_DEBUG("%s %u bytes, batch %u, %s, %u ms per run\n",
+		 stress_cache ? "test_cache" : "kmalloc",
+		 stress_cache ? kmem_cache_size(test_cache) : stress_size,
+		 stress_batch, stress_pattern_names[pattern], stress_ms);
+
+	if (stress_threads)
+		return stress_run_threads(min(stress_threads, max_nr), pattern);
+
+	for (nr = 1; !err; nr = min(nr * 2, max_nr)) {
+		err = stress_run_threads(nr, pattern);
+		if (nr == max_nr)
+			break;
+	}
+	return err;
+}
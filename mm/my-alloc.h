@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2026 Bruno E. O. Meneguele <bmeneguele@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 2 as published by the
+ * Free Software Foundation.
+ */
+
+#ifndef __MY_ALLOC_H
+#define __MY_ALLOC_H
+
+#include <linux/types.h>
+#include <linux/slab.h>
+
+struct test {
+	/* Kernel has its own defined types, for example these used in this
+	 * structure. If certain code is architecture sensible it's a good idea
+	 * define the type explicitly, i.e. u64, u32, ..., but when code is
+	 * generic the default C type might be used. */
+	u64 first;
+	u32 second;
+};
+
+struct page;
+struct dentry;
+
+/* Dedicated struct test cache, see my-alloc-main.c */
+extern struct kmem_cache *test_cache;
+
+/* debugfs directory of the module: my-alloc/ */
+extern struct dentry *my_alloc_debugfs;
+
+/* Page refcount tracer, see my-alloc-pgref.c */
+int pgref_trace_start(void);
+void pgref_trace_stop(void);
+int pgref_watch(struct page *page);
+
+/* Slab occupancy report of our caches, see my-alloc-slabinfo.c */
+int slabinfo_add(struct kmem_cache *cache, const char *name, size_t payload);
+void slabinfo_del(struct kmem_cache *cache);
+void slabinfo_debugfs_init(void);
+
+/* Batched test_cache allocation, see my-alloc-bulk.c */
+int test_alloc_bulk(gfp_t gfp, size_t nr, struct test **objs);
+void test_free_bulk(size_t nr, struct test **objs);
+
+/*
+ * Optional benchmark modes, selected with the 'mode' module parameter. Each
+ * one lives in its own my-alloc-<mode>.c file and returns 0 or -errno.
+ */
+struct my_alloc_mode {
+	const char *name;
+	int (*run)(void);
+};
+
+int my_alloc_numa_run(void);
+int my_alloc_stress_run(void);
+int my_alloc_remote_run(void);
+int my_alloc_bulk_run(void);
+int my_alloc_huge_run(void);
+int my_alloc_frag_run(void);
+int my_alloc_memcg_run(void);
+
+#endif /* __MY_ALLOC_H */
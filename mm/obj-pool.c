@@ -0,0 +1,377 @@
+/*
+ * Copyright (c) 2026 Bruno E. O. Meneguele <bmeneguele@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 2 as published by the
+ * Free Software Foundation.
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/percpu.h>
+#include <linux/shrinker.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+
+#include "obj-pool.h"
+#include "kmprof.h"
+
+static struct dentry *obj_pool_debugfs;
+
+static struct obj_pool_mag *obj_pool_mag_alloc(gfp_t gfp, int node)
+{
+	struct obj_pool_mag *mag;
+
+	mag = kmprof_kmalloc_node(sizeof(*mag), gfp, node);
+	if (mag) {
+		INIT_LIST_HEAD(&mag->list);
+		mag->count = 0;
+	}
+	return mag;
+}
+
+/* Give every object held by 'mag' back to the backing cache */
+static void obj_pool_mag_flush(struct obj_pool *pool, struct obj_pool_mag *mag)
+{
+	if (mag->count)
+		kmem_cache_free_bulk(pool->cache, mag->count, mag->objs);
+	mag->count = 0;
+}
+
+/* Must be called with depot_lock held */
+static struct obj_pool_mag *obj_pool_depot_pop(struct list_head *head,
+					       unsigned int *nr)
+{
+	struct obj_pool_mag *mag;
+
+	mag = list_first_entry_or_null(head, struct obj_pool_mag, list);
+	if (mag) {
+		list_del(&mag->list);
+		(*nr)--;
+	}
+	return mag;
+}
+
+/* Must be called with depot_lock held */
+static void obj_pool_depot_push(struct list_head *head, unsigned int *nr,
+				struct obj_pool_mag *mag)
+{
+	list_add(&mag->list, head);
+	(*nr)++;
+}
+
+/*
+ * Both per-CPU magazines are empty: try the 'prev' spare and then a full
+ * magazine from the depot. If the depot is dry as well a new magazine is
+ * filled straight from the backing cache, outside any lock since 'gfp' may
+ * allow us to sleep.
+ */
+void *__obj_pool_alloc_slow(struct obj_pool *pool, gfp_t gfp)
+{
+	struct obj_pool_cpu *pc;
+	struct obj_pool_mag *mag;
+	void *obj = NULL;
+
+	local_lock(&pool->cpu->lock);
+	pc = this_cpu_ptr(pool->cpu);
+	if (!pc->loaded->count && pc->prev->count)
+		swap(pc->loaded, pc->prev);
+
+	if (!pc->loaded->count) {
+		spin_lock(&pool->depot_lock);
+		mag = obj_pool_depot_pop(&pool->full, &pool->nr_full);
+		if (mag) {
+			obj_pool_depot_push(&pool->empty, &pool->nr_empty,
+					    pc->loaded);
+			pc->loaded = mag;
+		}
+		spin_unlock(&pool->depot_lock);
+	}
+
+	if (pc->loaded->count) {
+		obj = pc->loaded->objs[--pc->loaded->count];
+		pc->hits++;
+	}
+	local_unlock(&pool->cpu->lock);
+
+	if (obj)
+		return obj;
+
+	atomic_long_inc(&pool->misses);
+
+	spin_lock(&pool->depot_lock);
+	mag = obj_pool_depot_pop(&pool->empty, &pool->nr_empty);
+	spin_unlock(&pool->depot_lock);
+	if (!mag) {
+		mag = obj_pool_mag_alloc(gfp, numa_node_id());
+		if (!mag)
+			return NULL;
+	}
+
+	mag->count = kmem_cache_alloc_bulk(pool->cache, gfp, OBJ_POOL_MAG_SIZE,
+					   mag->objs);
+	if (mag->count)
+		obj = mag->objs[--mag->count];
+
+	/* The remaining objects are published to every CPU through the depot,
+	 * the next slow path of this CPU will most likely pick them up */
+	spin_lock(&pool->depot_lock);
+	if (mag->count)
+		obj_pool_depot_push(&pool->full, &pool->nr_full, mag);
+	else
+		obj_pool_depot_push(&pool->empty, &pool->nr_empty, mag);
+	spin_unlock(&pool->depot_lock);
+
+	return obj;
+}
+EXPORT_SYMBOL_GPL(__obj_pool_alloc_slow);
+
+/*
+ * Both per-CPU magazines are full: hand 'loaded' to the depot in exchange of
+ * an empty one. When the depot holds more than 'depot_max' full magazines the
+ * oldest is flushed back to the backing cache.
+ */
+void __obj_pool_free_slow(struct obj_pool *pool, void *obj)
+{
+	struct obj_pool_cpu *pc;
+	struct obj_pool_mag *mag, *trim = NULL;
+	bool retried = false;
+
+retry:
+	local_lock(&pool->cpu->lock);
+	pc = this_cpu_ptr(pool->cpu);
+	if (pc->loaded->count == OBJ_POOL_MAG_SIZE &&
+	    pc->prev->count < OBJ_POOL_MAG_SIZE)
+		swap(pc->loaded, pc->prev);
+
+	if (pc->loaded->count == OBJ_POOL_MAG_SIZE) {
+		spin_lock(&pool->depot_lock);
+		mag = obj_pool_depot_pop(&pool->empty, &pool->nr_empty);
+		if (mag) {
+			obj_pool_depot_push(&pool->full, &pool->nr_full,
+					    pc->loaded);
+			pc->loaded = mag;
+			if (pool->nr_full > pool->depot_max) {
+				trim = list_last_entry(&pool->full,
+						       struct obj_pool_mag,
+						       list);
+				list_del(&trim->list);
+				pool->nr_full--;
+			}
+		}
+		spin_unlock(&pool->depot_lock);
+	}
+
+	if (pc->loaded->count < OBJ_POOL_MAG_SIZE) {
+		pc->loaded->objs[pc->loaded->count++] = obj;
+		obj = NULL;
+	}
+	local_unlock(&pool->cpu->lock);
+
+	if (trim) {
+		obj_pool_mag_flush(pool, trim);
+		spin_lock(&pool->depot_lock);
+		obj_pool_depot_push(&pool->empty, &pool->nr_empty, trim);
+		spin_unlock(&pool->depot_lock);
+	}
+
+	if (!obj)
+		return;
+
+	/* No empty magazine in the depot. Free paths must not sleep nor fail,
+	 * so try once to get a new magazine without blocking and fall back to
+	 * the backing cache otherwise. */
+	if (!retried) {
+		mag = obj_pool_mag_alloc(GFP_NOWAIT | __GFP_NOWARN,
+					 numa_node_id());
+		if (mag) {
+			spin_lock(&pool->depot_lock);
+			obj_pool_depot_push(&pool->empty, &pool->nr_empty, mag);
+			spin_unlock(&pool->depot_lock);
+			retried = true;
+			goto retry;
+		}
+	}
+	kmem_cache_free(pool->cache, obj);
+}
+EXPORT_SYMBOL_GPL(__obj_pool_free_slow);
+
+static unsigned long obj_pool_shrink_count(struct shrinker *shrink,
+					   struct shrink_control *sc)
+{
+	struct obj_pool *pool = shrink->private_data;
+	unsigned long nr;
+
+	nr = (unsigned long)READ_ONCE(pool->nr_full) * OBJ_POOL_MAG_SIZE;
+	return nr ? nr : SHRINK_EMPTY;
+}
+
+/*
+ * Give the depot objects back to the backing cache, oldest magazines first.
+ * Empty magazines are freed as well, a pool under pressure doesn't need them.
+ */
+static unsigned long obj_pool_shrink_scan(struct shrinker *shrink,
+					  struct shrink_control *sc)
+{
+	struct obj_pool *pool = shrink->private_data;
+	struct obj_pool_mag *mag, *tmp;
+	unsigned long freed = 0;
+	LIST_HEAD(reclaim);
+
+	spin_lock(&pool->depot_lock);
+	while (freed < sc->nr_to_scan && pool->nr_full) {
+		mag = list_last_entry(&pool->full, struct obj_pool_mag, list);
+		list_move(&mag->list, &reclaim);
+		pool->nr_full--;
+		freed += mag->count;
+	}
+	list_splice_init(&pool->empty, &reclaim);
+	pool->nr_empty = 0;
+	spin_unlock(&pool->depot_lock);
+
+	list_for_each_entry_safe(mag, tmp, &reclaim, list) {
+		obj_pool_mag_flush(pool, mag);
+		kmprof_kfree(mag);
+	}
+
+	atomic_long_add(freed, &pool->reclaimed);
+	sc->nr_scanned = freed;
+	return freed ? freed : SHRINK_STOP;
+}
+
+void obj_pool_get_stats(struct obj_pool *pool, struct obj_pool_stats *stats)
+{
+	int cpu;
+
+	stats->hits = 0;
+	for_each_possible_cpu(cpu)
+		stats->hits += READ_ONCE(per_cpu_ptr(pool->cpu, cpu)->hits);
+	stats->misses = atomic_long_read(&pool->misses);
+	stats->reclaimed = atomic_long_read(&pool->reclaimed);
+	stats->nr_full = READ_ONCE(pool->nr_full);
+	stats->nr_empty = READ_ONCE(pool->nr_empty);
+}
+EXPORT_SYMBOL_GPL(obj_pool_get_stats);
+
+static int obj_pool_stats_show(struct seq_file *m, void *v)
+{
+	struct obj_pool *pool = m->private;
+	struct obj_pool_stats stats;
+
+	obj_pool_get_stats(pool, &stats);
+	seq_printf(m, "hits %lu\nmisses %lu\nreclaimed %lu\n"
+		   "depot_full %u\ndepot_empty %u\n", stats.hits,
+		   stats.misses, stats.reclaimed, stats.nr_full,
+		   stats.nr_empty);
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(obj_pool_stats);
+
+int obj_pool_init(struct obj_pool *pool, const char *name,
+		  struct kmem_cache *cache, unsigned int depot_max)
+{
+	struct obj_pool_cpu *pc;
+	int cpu;
+
+	pool->name = name;
+	pool->cache = cache;
+	pool->depot_max = depot_max;
+	pool->nr_full = 0;
+	pool->nr_empty = 0;
+	INIT_LIST_HEAD(&pool->full);
+	INIT_LIST_HEAD(&pool->empty);
+	spin_lock_init(&pool->depot_lock);
+	atomic_long_set(&pool->misses, 0);
+	atomic_long_set(&pool->reclaimed, 0);
+	pool->shrinker = NULL;
+	pool->debugfs = NULL;
+
+	pool->cpu = alloc_percpu(struct obj_pool_cpu);
+	if (!pool->cpu)
+		return -ENOMEM;
+
+	for_each_possible_cpu(cpu) {
+		pc = per_cpu_ptr(pool->cpu, cpu);
+		local_lock_init(&pc->lock);
+		pc->loaded = obj_pool_mag_alloc(GFP_KERNEL, cpu_to_node(cpu));
+		pc->prev = obj_pool_mag_alloc(GFP_KERNEL, cpu_to_node(cpu));
+		if (!pc->loaded || !pc->prev)
+			goto err;
+	}
+
+	pool->shrinker = shrinker_alloc(0, "obj-pool-%s", name);
+	if (!pool->shrinker)
+		goto err;
+	pool->shrinker->count_objects = obj_pool_shrink_count;
+	pool->shrinker->scan_objects = obj_pool_shrink_scan;
+	pool->shrinker->private_data = pool;
+	shrinker_register(pool->shrinker);
+
+	pool->debugfs = debugfs_create_file(name, 0444, obj_pool_debugfs, pool,
+					    &obj_pool_stats_fops);
+	return 0;
+err:
+	obj_pool_destroy(pool);
+	return -ENOMEM;
+}
+EXPORT_SYMBOL_GPL(obj_pool_init);
+
+/* The caller must guarantee nobody else is using the pool anymore */
+void obj_pool_destroy(struct obj_pool *pool)
+{
+	struct obj_pool_mag *mag, *tmp;
+	struct obj_pool_cpu *pc;
+	int cpu;
+
+	if (!pool->cpu)
+		return;
+
+	debugfs_remove(pool->debugfs);
+	pool->debugfs = NULL;
+	/* Waits for running scans, the depot is ours after that */
+	shrinker_free(pool->shrinker);
+	pool->shrinker = NULL;
+
+	for_each_possible_cpu(cpu) {
+		pc = per_cpu_ptr(pool->cpu, cpu);
+		if (pc->loaded)
+			obj_pool_mag_flush(pool, pc->loaded);
+		if (pc->prev)
+			obj_pool_mag_flush(pool, pc->prev);
+		kmprof_kfree(pc->loaded);
+		kmprof_kfree(pc->prev);
+	}
+	free_percpu(pool->cpu);
+	pool->cpu = NULL;
+
+	list_for_each_entry_safe(mag, tmp, &pool->full, list) {
+		obj_pool_mag_flush(pool, mag);
+		kmprof_kfree(mag);
+	}
+	list_for_each_entry_safe(mag, tmp, &pool->empty, list)
+		kmprof_kfree(mag);
+	INIT_LIST_HEAD(&pool->full);
+	INIT_LIST_HEAD(&pool->empty);
+	pool->nr_full = 0;
+	pool->nr_empty = 0;
+}
+EXPORT_SYMBOL_GPL(obj_pool_destroy);
+
+static int __init obj_pool_module_init(void)
+{
+	obj_pool_debugfs = debugfs_create_dir("obj-pool", NULL);
+	return 0;
+}
+
+static void __exit obj_pool_module_exit(void)
+{
+	debugfs_remove_recursive(obj_pool_debugfs);
+}
+
+module_init(obj_pool_module_init);
+module_exit(obj_pool_module_exit);
+
+MODULE_AUTHOR("Bruno E. O. Meneguele <bmeneguele@gmail.com>");
+MODULE_DESCRIPTION("Per-CPU magazine based object pool");
+MODULE_LICENSE("GPL");
@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2026 Bruno E. O. Meneguele <bmeneguele@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 2 as published by the
+ * Free Software Foundation.
+ */
+
+#ifndef __OBJ_POOL_H
+#define __OBJ_POOL_H
+
+#include <linux/types.h>
+#include <linux/list.h>
+#include <linux/percpu.h>
+#include <linux/spinlock.h>
+#include <linux/local_lock.h>
+#include <linux/slab.h>
+#include <linux/atomic.h>
+
+/*
+ * Per-CPU object pool on top of a kmem_cache, following the magazine/depot
+ * design (Bonwick & Adams, "Magazines and Vmem", USENIX 2001).
+ *
+ * Every CPU owns two magazines (small stacks of object pointers): 'loaded',
+ * where objects are popped from and pushed to, and 'prev', used as a spare so
+ * a CPU bouncing around a magazine boundary doesn't hit the depot on every
+ * call. When both are exhausted the CPU exchanges a whole magazine with the
+ * shared depot, and only when the depot is dry objects come from the backing
+ * cache, OBJ_POOL_MAG_SIZE at a time through kmem_cache_alloc_bulk().
+ *
+ * The fast paths only disable preemption (local_lock), there is no atomic
+ * operation and no shared cacheline written. As a consequence the pool must
+ * not be used from interrupt context, hard or soft.
+ *
+ * Under memory pressure a shrinker gives the objects parked in the depot back
+ * to the backing cache. Per-CPU magazines are left alone, they hold at most
+ * 2 * OBJ_POOL_MAG_SIZE objects per CPU. Hit, miss and reclaim counters are
+ * exported as obj-pool/<name> in debugfs.
+ */
+
+/* Number of objects moved between a CPU and the depot at once */
+#define OBJ_POOL_MAG_SIZE	32
+
+struct obj_pool_mag {
+	struct list_head list;
+	unsigned int count;
+	void *objs[OBJ_POOL_MAG_SIZE];
+};
+
+struct obj_pool_cpu {
+	local_lock_t lock;
+	struct obj_pool_mag *loaded;
+	struct obj_pool_mag *prev;
+	/* Allocations served by the pool, only written by the owner CPU */
+	unsigned long hits;
+};
+
+struct obj_pool_stats {
+	/* Allocations served by the pool */
+	unsigned long hits;
+	/* Allocations that had to refill from the backing cache */
+	unsigned long misses;
+	/* Objects given back to the backing cache by the shrinker */
+	unsigned long reclaimed;
+	unsigned int nr_full;
+	unsigned int nr_empty;
+};
+
+struct obj_pool {
+	const char *name;
+	/* Backing cache, owned by the pool user */
+	struct kmem_cache *cache;
+	struct obj_pool_cpu __percpu *cpu;
+
+	/* Depot: magazines shared by all CPUs */
+	spinlock_t depot_lock;
+	struct list_head full;
+	struct list_head empty;
+	unsigned int nr_full;
+	unsigned int nr_empty;
+	/* Full magazines kept in the depot before giving objects back to the
+	 * backing cache */
+	unsigned int depot_max;
+
+	atomic_long_t misses;
+	atomic_long_t reclaimed;
+	struct shrinker *shrinker;
+	struct dentry *debugfs;
+};
+
+int obj_pool_init(struct obj_pool *pool, const char *name,
+		  struct kmem_cache *cache, unsigned int depot_max);
+void obj_pool_destroy(struct obj_pool *pool);
+void obj_pool_get_stats(struct obj_pool *pool, struct obj_pool_stats *stats);
+
+void *__obj_pool_alloc_slow(struct obj_pool *pool, gfp_t gfp);
+void __obj_pool_free_slow(struct obj_pool *pool, void *obj);
+
+static inline void *obj_pool_alloc(struct obj_pool *pool, gfp_t gfp)
+{
+	struct obj_pool_cpu *pc;
+	void *obj = NULL;
+
+	local_lock(&pool->cpu->lock);
+	pc = this_cpu_ptr(pool->cpu);
+	if (likely(pc->loaded->count)) {
+		obj = pc->loaded->objs[--pc->loaded->count];
+		pc->hits++;
+	}
+	local_unlock(&pool->cpu->lock);
+
+	if (likely(obj))
+		return obj;
+	return __obj_pool_alloc_slow(pool, gfp);
+}
+
+static inline void obj_pool_free(struct obj_pool *pool, void *obj)
+{
+	struct obj_pool_cpu *pc;
+	bool done = false;
+
+	local_lock(&pool->cpu->lock);
+	pc = this_cpu_ptr(pool->cpu);
+	if (likely(pc->loaded->count < OBJ_POOL_MAG_SIZE)) {
+		pc->loaded->objs[pc->loaded->count++] = obj;
+		done = true;
+	}
+	local_unlock(&pool->cpu->lock);
+
+	if (unlikely(!done))
+		__obj_pool_free_slow(pool, obj);
+}
+
+#endif /* __OBJ_POOL_H */
@@ -0,0 +1,333 @@
+/*
+ * Copyright (c) 2026 Bruno E. O. Meneguele <bmeneguele@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 2 as published by the
+ * Free Software Foundation.
+ */
+
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/kernel.h>
+#include <linux/cpumask.h>
+#include <linux/gfp.h>
+#include <linux/mm.h>
+#include <linux/ptr_ring.h>
+#include <linux/dma-mapping.h>
+#include <linux/platform_device.h>
+
+#include "utils.h"
+#include "bench.h"
+#include "pgpool.h"
+
+/*
+ * A producer kthread allocates pages, writes into them like a device filling
+ * RX buffers would and passes them through a queue to a consumer kthread on
+ * another CPU, which reads and frees them. Once with the page allocator, once
+ * with a pgpool where the consumer frees into the producer's ring.
+ *
+ * With dma=1 a dummy platform device is registered and pages are mapped for
+ * it: per page with the page allocator, once per page lifetime with the pool.
+ * On a box without IOMMU translation that's cheap, with iommu.strict=1 or
+ * swiotlb=force it's not.
+ *
+ * Example, after loading pgpool.ko:
+ * insmod pgpool-bench.ko bench_pages=10000000 producer_cpu=0 consumer_cpu=2
+ */
+static unsigned int bench_pages = 1000000;
+module_param(bench_pages, uint, 0444);
+MODULE_PARM_DESC(bench_pages, "Pages sent from producer to consumer per mode");
+
+static unsigned int ring_size = 1024;
+module_param(ring_size, uint, 0444);
+MODULE_PARM_DESC(ring_size, "Pages parked in the pool ring at most");
+
+static unsigned int queue_len = 256;
+module_param(queue_len, uint, 0444);
+MODULE_PARM_DESC(queue_len, "Pages in flight between producer and consumer");
+
+static unsigned int producer_cpu;
+module_param(producer_cpu, uint, 0444);
+MODULE_PARM_DESC(producer_cpu, "CPU allocating the pages");
+
+static unsigned int consumer_cpu = 1;
+module_param(consumer_cpu, uint, 0444);
+MODULE_PARM_DESC(consumer_cpu, "CPU freeing the pages");
+
+static bool dma;
+module_param(dma, bool, 0444);
+MODULE_PARM_DESC(dma, "DMA map the pages for a dummy device");
+
+enum pgpool_bench_mode {
+	PGPOOL_BENCH_BUDDY,
+	PGPOOL_BENCH_POOL,
+	PGPOOL_BENCH_NR_MODES,
+};
+
+static const char * const pgpool_bench_names[] = {
+	[PGPOOL_BENCH_BUDDY]	= "buddy",
+	[PGPOOL_BENCH_POOL]	= "pgpool",
+};
+
+struct pgpool_bench_ctx {
+	enum pgpool_bench_mode mode;
+	/* Producer to consumer queue */
+	struct ptr_ring queue;
+	/* Set by the producer once it's done, successfully or not */
+	bool stop;
+};
+
+static struct platform_device *bench_pdev;
+static struct device *bench_dev;
+static struct pgpool bench_pool;
+
+static void pgpool_bench_wait(unsigned long *spins)
+{
+	/* Both sides may share a CPU with other tasks, don't hog it */
+	if (!(++*spins & 1023))
+		cond_resched();
+	else
+		cpu_relax();
+}
+
+static struct page *pgpool_bench_alloc(enum pgpool_bench_mode mode)
+{
+	struct page *page;
+	dma_addr_t addr;
+
+	if (mode == PGPOOL_BENCH_POOL)
+		return pgpool_alloc(&bench_pool, GFP_KERNEL);
+
+	page = alloc_page(GFP_KERNEL);
+	if (!page || !bench_dev)
+		return page;
+
+	addr = dma_map_page(bench_dev, page, 0, PAGE_SIZE, DMA_FROM_DEVICE);
+	if (dma_mapping_error(bench_dev, addr)) {
+		__free_page(page);
+		return NULL;
+	}
+	set_page_private(page, addr);
+	return page;
+}
+
+static void pgpool_bench_free(enum pgpool_bench_mode mode, struct page *page)
+{
+	if (mode == PGPOOL_BENCH_POOL) {
+		pgpool_put_page(&bench_pool, page, false);
+		return;
+	}
+
+	if (bench_dev) {
+		dma_unmap_page(bench_dev, page_private(page), PAGE_SIZE,
+			       DMA_FROM_DEVICE);
+		set_page_private(page, 0);
+	}
+	__free_page(page);
+}
+
+static int pgpool_bench_producer(struct bench_thread *bt,
+				 struct pgpool_bench_ctx *ctx)
+{
+	unsigned long spins = 0;
+	struct page *page;
+	unsigned int i;
+	u64 start;
+	int err = 0;
+
+	start = ktime_get_ns();
+	for (i = 0; i < bench_pages; i++) {
+		page = pgpool_bench_alloc(ctx->mode);
+		if (!page) {
+			err = -ENOMEM;
+			break;
+		}
+		/* A header, as a NIC would write */
+		*(u64 *)page_address(page) = i;
+		while (ptr_ring_produce(&ctx->queue, page))
+			pgpool_bench_wait(&spins);
+	}
+	bt->ns = ktime_get_ns() - start;
+	bt->ops = i;
+
+	smp_store_release(&ctx->stop, true);
+	return err;
+}
+
+static int pgpool_bench_consumer(struct bench_thread *bt,
+				 struct pgpool_bench_ctx *ctx)
+{
+	unsigned long spins = 0;
+	unsigned int n = 0;
+	struct page *page;
+	u64 start, sum = 0;
+
+	start = ktime_get_ns();
+	while (n < bench_pages) {
+		page = ptr_ring_consume(&ctx->queue);
+		if (!page) {
+			/* Whatever was produced before stop is visible */
+			if (smp_load_acquire(&ctx->stop) &&
+			    ptr_ring_empty(&ctx->queue))
+				break;
+			pgpool_bench_wait(&spins);
+			continue;
+		}
+		sum += *(u64 *)page_address(page);
+		pgpool_bench_free(ctx->mode, page);
+		n++;
+	}
+	bt->ns = ktime_get_ns() - start;
+	bt->ops = n;
+
+	/* Sum of 0..n-1, checks every page made it through once */
+	if (n && sum != (u64)n * (n - 1) / 2) {
+		PR_ERROR("consumer read garbage\n");
+		return -EIO;
+	}
+	return 0;
+}
+
+static int pgpool_bench_fn(struct bench_thread *bt)
+{
+	struct pgpool_bench_ctx *ctx = bt->run->data;
+
+	if (bt->cpu == producer_cpu)
+		return pgpool_bench_producer(bt, ctx);
+	return pgpool_bench_consumer(bt, ctx);
+}
+
+static int pgpool_bench_run(struct bench_run *run,
+			    enum pgpool_bench_mode mode)
+{
+	struct pgpool_stats before, after;
+	struct pgpool_bench_ctx ctx = { .mode = mode };
+	struct bench_thread *prod, *cons;
+	unsigned long allocs, frees;
+	int err;
+
+	err = ptr_ring_init(&ctx.queue, queue_len, GFP_KERNEL);
+	if (err)
+		return err;
+
+	pgpool_get_stats(&bench_pool, &before);
+	err = bench_run_exec(run, pgpool_bench_fn, &ctx);
+	pgpool_get_stats(&bench_pool, &after);
+	ptr_ring_cleanup(&ctx.queue, NULL);
+	if (err)
+		return err;
+
+	if (mode == PGPOOL_BENCH_POOL) {
+		allocs = after.alloc_slow - before.alloc_slow;
+		frees = after.released - before.released;
+	} else {
+		allocs = frees = bench_pages;
+	}
+
+	prod = &run->threads[0];
+	cons = &run->threads[1];
+	if (prod->cpu != producer_cpu)
+		swap(prod, cons);
+	PR_DEBUG("%-6s: producer " BENCH_FP_FMT " ns/page, consumer "
+		 BENCH_FP_FMT " ns/page, " BENCH_FP_FMT " Mpages/s, page "
+		 "allocator %lu allocs %lu frees\n", pgpool_bench_names[mode],
+		 BENCH_FP_ARG(bench_ns_per_op(prod->ns, prod->ops)),
+		 BENCH_FP_ARG(bench_ns_per_op(cons->ns, cons->ops)),
+		 BENCH_FP_ARG(bench_mops(run->wall_ns, cons->ops)),
+		 allocs, frees);
+	if (mode == PGPOOL_BENCH_POOL)
+		PR_DEBUG("pgpool: %lu cache refills, %lu pages recycled "
+			 "through the ring\n",
+			 after.alloc_refill - before.alloc_refill,
+			 after.recycle_ring - before.recycle_ring);
+	return 0;
+}
+
+/* Stands for a NIC, direct mapped unless an IOMMU is in the way */
+static int pgpool_bench_dev_init(void)
+{
+	int err;
+
+	bench_pdev = platform_device_register_simple("pgpool-bench",
+						     PLATFORM_DEVID_NONE,
+						     NULL, 0);
+	if (IS_ERR(bench_pdev))
+		return PTR_ERR(bench_pdev);
+
+	err = dma_coerce_mask_and_coherent(&bench_pdev->dev,
+					   DMA_BIT_MASK(64));
+	if (err) {
+		platform_device_unregister(bench_pdev);
+		return err;
+	}
+	bench_dev = &bench_pdev->dev;
+	return 0;
+}
+
+static int __init pgpool_bench_init(void)
+{
+	struct bench_run *run;
+	cpumask_var_t cpus;
+	int mode, err;
+
+	if (!bench_pages || !ring_size || !queue_len ||
+	    producer_cpu == consumer_cpu || !cpu_online(producer_cpu) ||
+	    !cpu_online(consumer_cpu)) {
+		PR_ERROR("need two distinct online CPUs\n");
+		return -EINVAL;
+	}
+
+	if (!zalloc_cpumask_var(&cpus, GFP_KERNEL))
+		return -ENOMEM;
+	cpumask_set_cpu(producer_cpu, cpus);
+	cpumask_set_cpu(consumer_cpu, cpus);
+	run = bench_run_alloc("pgpool-bench", cpus, 2);
+	free_cpumask_var(cpus);
+	if (IS_ERR(run))
+		return PTR_ERR(run);
+
+	if (dma) {
+		err = pgpool_bench_dev_init();
+		if (err)
+			goto err_run;
+	}
+
+	err = pgpool_init(&bench_pool, "pgpool-bench", ring_size,
+			  cpu_to_node(producer_cpu), bench_dev,
+			  DMA_FROM_DEVICE);
+	if (err)
+		goto err_dev;
+
+	PR_DEBUG("%u pages from CPU %u to CPU %u, queue %u, pool ring %u%s\n",
+		 bench_pages, producer_cpu, consumer_cpu, queue_len, ring_size,
+		 bench_dev ? ", DMA mapped" : "");
+	for (mode = 0; mode < PGPOOL_BENCH_NR_MODES; mode++) {
+		err = pgpool_bench_run(run, mode);
+		if (err) {
+			PR_ERROR("%s failed: %d\n", pgpool_bench_names[mode],
+				 err);
+			break;
+		}
+	}
+
+	pgpool_destroy(&bench_pool);
+err_dev:
+	if (bench_pdev)
+		platform_device_unregister(bench_pdev);
+err_run:
+	bench_run_free(run);
+	return err;
+}
+
+static void __exit pgpool_bench_exit(void)
+{
+	PR_DEBUG("module unloaded\n");
+}
+
+module_init(pgpool_bench_init);
+module_exit(pgpool_bench_exit);
+
+MODULE_AUTHOR("Bruno E. O. Meneguele <bmeneguele@gmail.com>");
+MODULE_DESCRIPTION("Page recycling pool versus the page allocator");
+MODULE_LICENSE("GPL");
@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) 2026 Bruno E. O. Meneguele <bmeneguele@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 2 as published by the
+ * Free Software Foundation.
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/gfp.h>
+#include <linux/mm.h>
+#include <linux/ptr_ring.h>
+#include <linux/dma-mapping.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+
+#include "utils.h"
+#include "pgpool.h"
+
+static struct dentry *pgpool_debugfs;
+
+/* Back to the page allocator, for good */
+static void pgpool_release(struct pgpool *pool, struct page *page)
+{
+	if (pool->dev) {
+		dma_unmap_page_attrs(pool->dev, pgpool_page_dma(page),
+				     PAGE_SIZE, pool->dma_dir,
+				     DMA_ATTR_SKIP_CPU_SYNC);
+		set_page_private(page, 0);
+	}
+	atomic_long_inc(&pool->released);
+	put_page(page);
+}
+
+/*
+ * The cache is empty: take a batch from the ring, where consumers put pages
+ * back, and only then go to the page allocator.
+ */
+struct page *__pgpool_alloc_slow(struct pgpool *pool, gfp_t gfp)
+{
+	struct page *page;
+	dma_addr_t dma;
+
+	pool->count = ptr_ring_consume_batched_bh(&pool->ring,
+						  (void **)pool->cache,
+						  PGPOOL_REFILL);
+	if (pool->count) {
+		pool->alloc_refill++;
+		pool->alloc_fast++;
+		return pool->cache[--pool->count];
+	}
+
+	page = alloc_pages_node(pool->nid, gfp, 0);
+	if (!page)
+		return NULL;
+
+	if (pool->dev) {
+		dma = dma_map_page_attrs(pool->dev, page, 0, PAGE_SIZE,
+					 pool->dma_dir, DMA_ATTR_SKIP_CPU_SYNC);
+		if (dma_mapping_error(pool->dev, dma)) {
+			__free_page(page);
+			return NULL;
+		}
+		set_page_private(page, dma);
+	}
+	pool->alloc_slow++;
+	return page;
+}
+EXPORT_SYMBOL_GPL(__pgpool_alloc_slow);
+
+/*
+ * Give 'page' back to the pool. 'direct' tells the caller is the producer,
+ * which may use the cache. Pages someone else still holds a reference to, or
+ * from another node than the pool's, aren't recycled.
+ */
+void pgpool_put_page(struct pgpool *pool, struct page *page, bool direct)
+{
+	if (unlikely(page_ref_count(page) != 1 || page_is_pfmemalloc(page) ||
+		     (pool->nid != NUMA_NO_NODE &&
+		      page_to_nid(page) != pool->nid))) {
+		pgpool_release(pool, page);
+		return;
+	}
+
+	/* The device may write the whole page before the CPU looks at it */
+	if (pool->dev)
+		dma_sync_single_range_for_device(pool->dev,
+						 pgpool_page_dma(page), 0,
+						 PAGE_SIZE, pool->dma_dir);
+
+	if (direct && pool->count < PGPOOL_CACHE_SIZE) {
+		pool->cache[pool->count++] = page;
+		pool->recycle_cached++;
+		return;
+	}
+
+	if (!ptr_ring_produce_bh(&pool->ring, page)) {
+		atomic_long_inc(&pool->recycle_ring);
+		return;
+	}
+	pgpool_release(pool, page);
+}
+EXPORT_SYMBOL_GPL(pgpool_put_page);
+
+/* Producer counters are read racily, fine for statistics */
+void pgpool_get_stats(struct pgpool *pool, struct pgpool_stats *stats)
+{
+	stats->alloc_fast = READ_ONCE(pool->alloc_fast);
+	stats->alloc_refill = READ_ONCE(pool->alloc_refill);
+	stats->alloc_slow = READ_ONCE(pool->alloc_slow);
+	stats->recycle_cached = READ_ONCE(pool->recycle_cached);
+	stats->recycle_ring = atomic_long_read(&pool->recycle_ring);
+	stats->released = atomic_long_read(&pool->released);
+}
+EXPORT_SYMBOL_GPL(pgpool_get_stats);
+
+static int pgpool_stats_show(struct seq_file *m, void *v)
+{
+	struct pgpool *pool = m->private;
+	struct pgpool_stats stats;
+
+	pgpool_get_stats(pool, &stats);
+	seq_printf(m, "alloc_fast %lu\nalloc_refill %lu\nalloc_slow %lu\n"
+		   "recycle_cached %lu\nrecycle_ring %lu\nreleased %lu\n"
+		   "inflight %ld\n", stats.alloc_fast, stats.alloc_refill,
+		   stats.alloc_slow, stats.recycle_cached, stats.recycle_ring,
+		   stats.released, (long)(stats.alloc_slow - stats.released));
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(pgpool_stats);
+
+/*
+ * 'ring_size' bounds the pages parked in the pool on top of the cache, past
+ * that they go back to the page allocator. 'nid' may be NUMA_NO_NODE, 'dev'
+ * NULL when pages aren't used for DMA.
+ */
+int pgpool_init(struct pgpool *pool, const char *name, unsigned int ring_size,
+		int nid, struct device *dev, enum dma_data_direction dma_dir)
+{
+	int err;
+
+	/* The DMA address is kept in page->private */
+	if (dev && sizeof(dma_addr_t) > sizeof(unsigned long))
+		return -EOPNOTSUPP;
+
+	memset(pool, 0, sizeof(*pool));
+	pool->name = name;
+	pool->nid = nid;
+	pool->dev = dev;
+	pool->dma_dir = dma_dir;
+	atomic_long_set(&pool->recycle_ring, 0);
+	atomic_long_set(&pool->released, 0);
+
+	err = ptr_ring_init(&pool->ring, ring_size, GFP_KERNEL);
+	if (err)
+		return err;
+
+	pool->debugfs = debugfs_create_file(name, 0444, pgpool_debugfs, pool,
+					    &pgpool_stats_fops);
+	return 0;
+}
+EXPORT_SYMBOL_GPL(pgpool_init);
+
+/*
+ * Every page must have been put back by now, the ones still out there are
+ * reported and leaked: they may still be DMA mapped.
+ */
+void pgpool_destroy(struct pgpool *pool)
+{
+	struct page *page;
+	long inflight;
+
+	debugfs_remove(pool->debugfs);
+	pool->debugfs = NULL;
+
+	while (pool->count)
+		pgpool_release(pool, pool->cache[--pool->count]);
+	while ((page = ptr_ring_consume_bh(&pool->ring)))
+		pgpool_release(pool, page);
+	ptr_ring_cleanup(&pool->ring, NULL);
+
+	inflight = pool->alloc_slow - atomic_long_read(&pool->released);
+	if (inflight)
+		PR_ERROR("%s: %ld pages never put back\n", pool->name,
+			 inflight);
+}
+EXPORT_SYMBOL_GPL(pgpool_destroy);
+
+static int __init pgpool_module_init(void)
+{
+	pgpool_debugfs = debugfs_create_dir("pgpool", NULL);
+	return 0;
+}
+
+static void __exit pgpool_module_exit(void)
+{
+	debugfs_remove_recursive(pgpool_debugfs);
+}
+
+module_init(pgpool_module_init);
+module_exit(pgpool_module_exit);
+
+MODULE_AUTHOR("Bruno E. O. Meneguele <bmeneguele@gmail.com>");
+MODULE_DESCRIPTION("page_pool like recycling pool of order-0 pages");
+MODULE_LICENSE("GPL");
@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2026 Bruno E. O. Meneguele <bmeneguele@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 2 as published by the
+ * Free Software Foundation.
+ */
+
+#ifndef __PGPOOL_H
+#define __PGPOOL_H
+
+#include <linux/types.h>
+#include <linux/mm.h>
+#include <linux/ptr_ring.h>
+#include <linux/atomic.h>
+#include <linux/cache.h>
+#include <linux/dma-mapping.h>
+
+/*
+ * Recycling pool of order-0 pages, modelled on the networking page_pool.
+ *
+ * A pool has a single producer, the context allocating pages (a NIC RX path,
+ * a kthread filling buffers), and any number of consumers freeing them. Pages
+ * put back by the producer itself land in 'cache', a plain array only the
+ * producer touches. Pages put back by anybody else go to 'ring', a ptr_ring
+ * the producer drains into the cache PGPOOL_REFILL pages at a time when the
+ * cache runs dry. Only when both are empty the page allocator is called, and
+ * pages only go back to it when the ring is full.
+ *
+ * With a device given to pgpool_init(), pages are DMA mapped once when they
+ * come from the page allocator and stay mapped while they cycle through the
+ * pool, the address is kept in page->private (see pgpool_page_dma()).
+ *
+ * pgpool_alloc() must only be called by the producer, pgpool_put_page() from
+ * any context but hard interrupts. Counters are exported as pgpool/<name> in
+ * debugfs.
+ */
+
+#define PGPOOL_CACHE_SIZE	128
+#define PGPOOL_REFILL		64
+
+struct dentry;
+
+struct pgpool_stats {
+	/* Pages served from the cache */
+	unsigned long alloc_fast;
+	/* Times the cache was refilled from the ring */
+	unsigned long alloc_refill;
+	/* Pages from the page allocator */
+	unsigned long alloc_slow;
+	/* Pages put back into the cache and into the ring */
+	unsigned long recycle_cached;
+	unsigned long recycle_ring;
+	/* Pages given back to the page allocator */
+	unsigned long released;
+};
+
+struct pgpool {
+	const char *name;
+	int nid;
+	/* NULL if pages aren't DMA mapped */
+	struct device *dev;
+	enum dma_data_direction dma_dir;
+
+	/* Producer side, no locking */
+	unsigned int count;
+	struct page *cache[PGPOOL_CACHE_SIZE];
+	unsigned long alloc_fast;
+	unsigned long alloc_refill;
+	unsigned long alloc_slow;
+	unsigned long recycle_cached;
+
+	/* Consumer side */
+	struct ptr_ring ring ____cacheline_aligned_in_smp;
+	atomic_long_t recycle_ring;
+	atomic_long_t released;
+	struct dentry *debugfs;
+};
+
+int pgpool_init(struct pgpool *pool, const char *name, unsigned int ring_size,
+		int nid, struct device *dev, enum dma_data_direction dma_dir);
+void pgpool_destroy(struct pgpool *pool);
+void pgpool_get_stats(struct pgpool *pool, struct pgpool_stats *stats);
+
+struct page *__pgpool_alloc_slow(struct pgpool *pool, gfp_t gfp);
+void pgpool_put_page(struct pgpool *pool, struct page *page, bool direct);
+
+static inline struct page *pgpool_alloc(struct pgpool *pool, gfp_t gfp)
+{
+	if (likely(pool->count)) {
+		pool->alloc_fast++;
+		return pool->cache[--pool->count];
+	}
+	return __pgpool_alloc_slow(pool, gfp);
+}
+
+static inline dma_addr_t pgpool_page_dma(struct page *page)
+{
+	return (dma_addr_t)page_private(page);
+}
+
+#endif /* __PGPOOL_H */
@@ -0,0 +1,262 @@
+/*
+ * Copyright (c) 2026 Bruno E. O. Meneguele <bmeneguele@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 2 as published by the
+ * Free Software Foundation.
+ */
+
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/cpumask.h>
+#include <linux/kthread.h>
+#include <linux/gfp.h>
+
+#include "utils.h"
+#include "bench.h"
+#include "obj-pool.h"
+
+/*
+ * Example, after loading obj-pool.ko:
+ * insmod pool-bench.ko bench_iters=10000000 batch=64
+ *
+ * With hog_mb set, a kthread keeps grabbing and releasing that much memory
+ * while the benchmark runs, pushing the system into reclaim so the pool
+ * shrinker has to give memory back. Set it close to MemAvailable.
+ */
+static unsigned int bench_iters = 1000000;
+module_param(bench_iters, uint, 0444);
+MODULE_PARM_DESC(bench_iters, "Allocations made by each CPU per mode");
+
+static unsigned int obj_size = 16;
+module_param(obj_size, uint, 0444);
+MODULE_PARM_DESC(obj_size, "Object size in bytes");
+
+static unsigned int batch = 16;
+module_param(batch, uint, 0444);
+MODULE_PARM_DESC(batch, "Objects held by a CPU before freeing them (LIFO)");
+
+static unsigned int hog_mb;
+module_param(hog_mb, uint, 0444);
+MODULE_PARM_DESC(hog_mb, "Memory hogged in background, in MiB (0 = none)");
+
+static unsigned int depot_max = 64;
+module_param(depot_max, uint, 0444);
+MODULE_PARM_DESC(depot_max, "Full magazines kept in the pool depot");
+
+#define POOL_BENCH_MAX_BATCH	4096
+
+enum pool_bench_mode {
+	POOL_BENCH_KMALLOC,
+	POOL_BENCH_CACHE,
+	POOL_BENCH_POOL,
+	POOL_BENCH_NR_MODES,
+};
+
+static const char * const pool_bench_names[] = {
+	[POOL_BENCH_KMALLOC]	= "kmalloc",
+	[POOL_BENCH_CACHE]	= "kmem_cache",
+	[POOL_BENCH_POOL]	= "obj_pool",
+};
+
+static struct kmem_cache *bench_cache;
+static struct obj_pool bench_pool;
+
+/* Allocations failed, by the benchmark itself or by the hog */
+static atomic_long_t bench_failures;
+static unsigned long hog_failures;
+
+static __always_inline void *pool_bench_alloc(enum pool_bench_mode mode)
+{
+	switch (mode) {
+	case POOL_BENCH_CACHE:
+		return kmem_cache_alloc(bench_cache, GFP_KERNEL);
+	case POOL_BENCH_POOL:
+		return obj_pool_alloc(&bench_pool, GFP_KERNEL);
+	default:
+		return kmalloc(obj_size, GFP_KERNEL);
+	}
+}
+
+static __always_inline void pool_bench_free(enum pool_bench_mode mode,
+					    void *obj)
+{
+	switch (mode) {
+	case POOL_BENCH_CACHE:
+		kmem_cache_free(bench_cache, obj);
+		break;
+	case POOL_BENCH_POOL:
+		obj_pool_free(&bench_pool, obj);
+		break;
+	default:
+		kfree(obj);
+	}
+}
+
+static int pool_bench_thread(struct bench_thread *bt)
+{
+	enum pool_bench_mode mode = (uintptr_t)bt->run->data;
+	unsigned int i, j, n;
+	void **objs;
+	u64 start;
+	int err = 0;
+
+	objs = kmalloc_array(batch, sizeof(*objs), GFP_KERNEL);
+	if (!objs)
+		return -ENOMEM;
+
+	start = ktime_get_ns();
+	for (i = 0; i < bench_iters; i += n) {
+		/* The last round may be short */
+		n = min(batch, bench_iters - i);
+		for (j = 0; j < n; j++) {
+			objs[j] = pool_bench_alloc(mode);
+			if (unlikely(!objs[j])) {
+				atomic_long_inc(&bench_failures);
+				err = -ENOMEM;
+				break;
+			}
+		}
+		while (j--)
+			pool_bench_free(mode, objs[j]);
+		if (unlikely(err))
+			break;
+		bt->ops += n;
+		cond_resched();
+	}
+	bt->ns = ktime_get_ns() - start;
+
+	kfree(objs);
+	return err;
+}
+
+/*
+ * Memory hog: fill up to hog_mb with pages and drop them, again and again.
+ * __GFP_NORETRY makes the hog back off instead of invoking the OOM killer,
+ * the reclaim it triggers on the way is what we are after.
+ */
+static int pool_hog_thread(void *data)
+{
+	unsigned long nr, target = (unsigned long)hog_mb << (20 - PAGE_SHIFT);
+	struct page *page, *tmp;
+	LIST_HEAD(pages);
+
+	while (!kthread_should_stop()) {
+		for (nr = 0; nr < target && !kthread_should_stop(); nr++) {
+			page = alloc_page(GFP_KERNEL | __GFP_NORETRY |
+					  __GFP_NOWARN);
+			if (!page) {
+				hog_failures++;
+				break;
+			}
+			list_add(&page->lru, &pages);
+			if (!(nr & 1023))
+				cond_resched();
+		}
+
+		list_for_each_entry_safe(page, tmp, &pages, lru) {
+			list_del(&page->lru);
+			__free_page(page);
+		}
+		cond_resched();
+	}
+	return 0;
+}
+
+static void pool_bench_report_pool(void)
+{
+	struct obj_pool_stats stats;
+
+	obj_pool_get_stats(&bench_pool, &stats);
+	PR_DEBUG("obj_pool: %lu hits, %lu misses, %lu reclaimed, depot %u "
+		 "full/%u empty\n", stats.hits, stats.misses, stats.reclaimed,
+		 stats.nr_full, stats.nr_empty);
+}
+
+static int __init pool_bench_init(void)
+{
+	struct task_struct *hog = NULL;
+	struct bench_run *run;
+	int mode, err;
+
+	if (!batch || batch > POOL_BENCH_MAX_BATCH || !obj_size) {
+		PR_ERROR("invalid batch (1-%u) or object size\n",
+			 POOL_BENCH_MAX_BATCH);
+		return -EINVAL;
+	}
+
+	/* Not merged with kmalloc-<obj_size>, or both modes share slabs */
+	bench_cache = kmem_cache_create("pool_bench", obj_size, 0,
+					SLAB_NO_MERGE, NULL);
+	if (!bench_cache)
+		return -ENOMEM;
+
+	/* The pool gets its own backing cache, otherwise SLUB would merge it
+	 * with bench_cache and both modes would share the same slabs */
+	err = -ENOMEM;
+	bench_pool.cache = kmem_cache_create("pool_bench_pool", obj_size, 0,
+					     SLAB_NO_MERGE, NULL);
+	if (!bench_pool.cache)
+		goto err_cache;
+	err = obj_pool_init(&bench_pool, "pool-bench", bench_pool.cache,
+			    depot_max);
+	if (err)
+		goto err_pool_cache;
+
+	run = bench_run_alloc("pool-bench", cpu_online_mask, 0);
+	if (IS_ERR(run)) {
+		err = PTR_ERR(run);
+		goto err_pool;
+	}
+
+	if (hog_mb) {
+		hog = kthread_run(pool_hog_thread, NULL, "pool-bench-hog");
+		if (IS_ERR(hog)) {
+			err = PTR_ERR(hog);
+			goto err_run;
+		}
+	}
+
+	PR_DEBUG("%u iterations, %u bytes objects, batch %u, hog %u MiB\n",
+		 bench_iters, obj_size, batch, hog_mb);
+	for (mode = 0; mode < POOL_BENCH_NR_MODES; mode++) {
+		err = bench_run_exec(run, pool_bench_thread,
+				     (void *)(uintptr_t)mode);
+		if (err) {
+			PR_ERROR("%s failed: %d\n", pool_bench_names[mode], err);
+			break;
+		}
+		bench_run_report(run, pool_bench_names[mode]);
+	}
+	pool_bench_report_pool();
+
+	if (hog) {
+		kthread_stop(hog);
+		PR_DEBUG("allocation failures: %ld benchmark, %lu hog\n",
+			 atomic_long_read(&bench_failures), hog_failures);
+	}
+err_run:
+	bench_run_free(run);
+err_pool:
+	obj_pool_destroy(&bench_pool);
+err_pool_cache:
+	kmem_cache_destroy(bench_pool.cache);
+err_cache:
+	kmem_cache_destroy(bench_cache);
+	return err;
+}
+
+static void __exit pool_bench_exit(void)
+{
+	PR_DEBUG("module unloaded\n");
+}
+
+module_init(pool_bench_init);
+module_exit(pool_bench_exit);
+
+MODULE_AUTHOR("Bruno E. O. Meneguele <bmeneguele@gmail.com>");
+MODULE_DESCRIPTION("Object pool versus kmalloc/kmem_cache benchmark");
+MODULE_LICENSE("GPL");
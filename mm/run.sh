@@ -4,5 +4,18 @@ MOD_NAME="my-alloc.ko"
 
 sudo rmmod $MOD_NAME
 make
-sudo insmod $MOD_NAME
+# KMPROF=y ./run.sh profiles our own kmallocs, see kmprof/sites in debugfs
+if [ "$KMPROF" = "y" ]; then
+	sudo insmod kmprof.ko
+fi
+# MEMCG=y ./run.sh mode=memcg loads the module from a child cgroup v2 with
+# the memory controller on, the root cgroup is never charged
+if [ "$MEMCG" = "y" ]; then
+	CG=/sys/fs/cgroup/my-alloc
+	echo +memory | sudo tee /sys/fs/cgroup/cgroup.subtree_control > /dev/null
+	sudo mkdir -p $CG
+	echo $$ | sudo tee $CG/cgroup.procs > /dev/null
+fi
+# Module parameters are passed through, e.g. ./run.sh mode=numa
+sudo insmod $MOD_NAME "$@"
 dmesg | tail
@@ -0,0 +1,376 @@
+/*
+ * Copyright (c) 2026 Bruno E. O. Meneguele <bmeneguele@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 2 as published by the
+ * Free Software Foundation.
+ */
+
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/gfp.h>
+#include <linux/mm.h>
+#include <linux/vmalloc.h>
+#include <linux/ktime.h>
+#include <linux/cpumask.h>
+
+#include "utils.h"
+#include "bench.h"
+
+/*
+ * Cost of TLB misses and page walks on a large in-kernel table. The same
+ * physical memory, order-9 compound pages, is reached through two mappings:
+ * - the direct map, which maps RAM with 2 MiB (or 1 GiB) entries
+ * - a vmap() of every 4 KiB subpage, which always uses 4 KiB PTEs
+ *
+ * Two kernels run over each mapping:
+ * - chase: a pointer chase over a random cyclic permutation of all the
+ *   cachelines, every load depends on the previous one, so each TLB miss is
+ *   paid in full
+ * - stream: a sequential read of every word, 'stream_passes' times, where
+ *   the prefetchers hide most of the walks
+ *
+ * Both mappings are indexed through the same chunk table, so only the page
+ * size differs. Time per access and, when the PMU exposes the event, dTLB
+ * read misses per access are reported. Example:
+ * insmod tlb-bench.ko size_mb=2048 chase_accesses=33554432
+ */
+static unsigned int size_mb = 512;
+module_param(size_mb, uint, 0444);
+MODULE_PARM_DESC(size_mb, "Table size in MiB");
+
+static unsigned long chase_accesses = 16UL << 20;
+module_param(chase_accesses, ulong, 0444);
+MODULE_PARM_DESC(chase_accesses, "Dependent loads per mapping");
+
+static unsigned int stream_passes = 4;
+module_param(stream_passes, uint, 0444);
+MODULE_PARM_DESC(stream_passes, "Sequential reads of the table per mapping");
+
+/* One PMD worth of pages, 2 MiB on x86_64 */
+#define TLB_CHUNK_ORDER		min(PMD_SHIFT - PAGE_SHIFT, MAX_PAGE_ORDER)
+#define TLB_CHUNK_PAGES		(1UL << TLB_CHUNK_ORDER)
+#define TLB_CHUNK_SIZE		(PAGE_SIZE << TLB_CHUNK_ORDER)
+#define TLB_CHUNK_LINES		(TLB_CHUNK_SIZE / sizeof(struct tlb_line))
+#define TLB_CHUNK_WORDS		(TLB_CHUNK_SIZE / sizeof(u64))
+
+/* A cacheline, 'next' is the index of the following line in the chase */
+struct tlb_line {
+	u64 next;
+	u64 pad[L1_CACHE_BYTES / sizeof(u64) - 1];
+};
+
+enum tlb_map {
+	TLB_MAP_4K,
+	TLB_MAP_DIRECT,
+	TLB_NR_MAPS,
+};
+
+static const char * const tlb_map_names[] = {
+	[TLB_MAP_4K]		= "vmap 4K",
+	[TLB_MAP_DIRECT]	= "direct map",
+};
+
+enum tlb_kernel {
+	TLB_CHASE,
+	TLB_STREAM,
+	TLB_NR_KERNELS,
+};
+
+static const char * const tlb_kernel_names[] = {
+	[TLB_CHASE]	= "chase",
+	[TLB_STREAM]	= "stream",
+};
+
+struct tlb_table {
+	unsigned int nr_chunks;
+	unsigned long nr_lines;
+	struct page **chunk_pages;
+	/* vmap() of all the subpages */
+	void *vaddr;
+	/* Chunk table per mapping */
+	struct tlb_line **chunks[TLB_NR_MAPS];
+};
+
+struct tlb_job {
+	struct tlb_table *table;
+	enum tlb_map map;
+	enum tlb_kernel kernel;
+	u64 accesses;
+	u64 misses;
+	bool counted;
+};
+
+/* Keeps the compiler from dropping the read loops */
+static u64 tlb_sink;
+
+static inline struct tlb_line *tlb_line(struct tlb_line **chunks, u64 idx)
+{
+	return &chunks[idx / TLB_CHUNK_LINES][idx % TLB_CHUNK_LINES];
+}
+
+static void tlb_table_free(struct tlb_table *table)
+{
+	unsigned int i;
+
+	if (table->vaddr)
+		vunmap(table->vaddr);
+	for (i = 0; i < TLB_NR_MAPS; i++)
+		kvfree(table->chunks[i]);
+	if (table->chunk_pages) {
+		for (i = 0; i < table->nr_chunks; i++)
+			if (table->chunk_pages[i])
+				__free_pages(table->chunk_pages[i],
+					     TLB_CHUNK_ORDER);
+		kvfree(table->chunk_pages);
+	}
+}
+
+/* Order-9 chunks, then a vmap() over their 4 KiB subpages */
+static int tlb_table_alloc(struct tlb_table *table, unsigned int nr_chunks)
+{
+	struct page **pages = NULL;
+	unsigned long i, j;
+	int err = -ENOMEM;
+
+	table->nr_chunks = nr_chunks;
+	table->nr_lines = nr_chunks * TLB_CHUNK_LINES;
+	table->chunk_pages = kvcalloc(nr_chunks, sizeof(struct page *),
+				      GFP_KERNEL);
+	for (i = 0; i < TLB_NR_MAPS; i++)
+		table->chunks[i] = kvcalloc(nr_chunks,
+					    sizeof(struct tlb_line *),
+					    GFP_KERNEL);
+	pages = kvmalloc_array(nr_chunks * TLB_CHUNK_PAGES, sizeof(*pages),
+			       GFP_KERNEL);
+	if (!table->chunk_pages || !table->chunks[TLB_MAP_4K] ||
+	    !table->chunks[TLB_MAP_DIRECT] || !pages)
+		goto out;
+
+	for (i = 0; i < nr_chunks; i++) {
+		table->chunk_pages[i] = alloc_pages(GFP_KERNEL | __GFP_COMP |
+						    __GFP_NOWARN,
+						    TLB_CHUNK_ORDER);
+		if (!table->chunk_pages[i])
+			goto out;
+		table->chunks[TLB_MAP_DIRECT][i] =
+			page_address(table->chunk_pages[i]);
+		for (j = 0; j < TLB_CHUNK_PAGES; j++)
+			pages[i * TLB_CHUNK_PAGES + j] =
+				table->chunk_pages[i] + j;
+	}
+
+	/* vmap() maps page by page, never with huge entries */
+	table->vaddr = vmap(pages, nr_chunks * TLB_CHUNK_PAGES, VM_MAP,
+			    PAGE_KERNEL);
+	if (!table->vaddr)
+		goto out;
+	for (i = 0; i < nr_chunks; i++)
+		table->chunks[TLB_MAP_4K][i] = table->vaddr +
+					       i * TLB_CHUNK_SIZE;
+	err = 0;
+out:
+	/* vmap() doesn't keep the array */
+	kvfree(pages);
+	return err;
+}
+
+static void tlb_line_swap(void *data, unsigned long i, unsigned long j)
+{
+	struct tlb_line **chunks = data;
+
+	swap(tlb_line(chunks, i)->next, tlb_line(chunks, j)->next);
+}
+
+/*
+ * Link all the lines in a single random cycle, so the chase visits every line
+ * before coming back and no prefetcher can guess the next one.
+ */
+static void tlb_table_link(struct tlb_table *table)
+{
+	struct tlb_line **chunks = table->chunks[TLB_MAP_DIRECT];
+	unsigned long i;
+
+	for (i = 0; i < table->nr_lines; i++) {
+		tlb_line(chunks, i)->next = i;
+		if (!(i & 0xffff))
+			cond_resched();
+	}
+	bench_sattolo(table->nr_lines, tlb_line_swap, chunks);
+}
+
+static u64 tlb_chase(struct tlb_line **chunks, u64 accesses)
+{
+	u64 i, idx = 0;
+
+	for (i = 0; i < accesses; i++) {
+		idx = tlb_line(chunks, idx)->next;
+		if (!(i & 0xffff))
+			cond_resched();
+	}
+	return idx;
+}
+
+static u64 tlb_stream(struct tlb_line **chunks, unsigned int nr_chunks)
+{
+	unsigned int pass, c;
+	const u64 *words;
+	u64 sum = 0;
+	unsigned long i;
+
+	for (pass = 0; pass < stream_passes; pass++) {
+		for (c = 0; c < nr_chunks; c++) {
+			words = (const u64 *)chunks[c];
+			for (i = 0; i < TLB_CHUNK_WORDS; i++)
+				sum += words[i];
+			cond_resched();
+		}
+	}
+	return sum;
+}
+
+static int tlb_thread(struct bench_thread *bt)
+{
+	struct tlb_job *job = bt->run->data;
+	struct tlb_table *table = job->table;
+	struct tlb_line **chunks = table->chunks[job->map];
+	u64 start, enabled, running, sum;
+	struct perf_event *ev;
+
+	ev = bench_perf_dtlb_create();
+	if (ev)
+		perf_event_enable(ev);
+
+	start = ktime_get_ns();
+	if (job->kernel == TLB_CHASE)
+		sum = tlb_chase(chunks, job->accesses);
+	else
+		sum = tlb_stream(chunks, table->nr_chunks);
+	bt->ns = ktime_get_ns() - start;
+	bt->ops = job->accesses;
+
+	if (ev) {
+		perf_event_disable(ev);
+		job->misses = perf_event_read_value(ev, &enabled, &running);
+		job->counted = true;
+		perf_event_release_kernel(ev);
+	}
+
+	WRITE_ONCE(tlb_sink, sum);
+	return 0;
+}
+
+static int tlb_measure(struct tlb_table *table, enum tlb_kernel kernel,
+		       enum tlb_map map)
+{
+	struct tlb_job job = {
+		.table = table,
+		.map = map,
+		.kernel = kernel,
+	};
+	struct bench_run *run;
+	u64 ns;
+	int err;
+
+	if (kernel == TLB_CHASE)
+		job.accesses = chase_accesses;
+	else
+		job.accesses = (u64)stream_passes * table->nr_chunks *
+			       TLB_CHUNK_WORDS;
+
+	run = bench_run_alloc("tlb-bench",
+			      cpumask_of(cpumask_first(cpu_online_mask)), 1);
+	if (IS_ERR(run))
+		return PTR_ERR(run);
+
+	err = bench_run_exec(run, tlb_thread, &job);
+	if (err)
+		goto out;
+
+	ns = bench_ns_per_op(run->threads[0].ns, job.accesses);
+	if (job.counted)
+		PR_DEBUG("%-6s %-10s: " BENCH_FP_FMT " ns/access, "
+			 BENCH_FP_FMT " dTLB misses/access\n",
+			 tlb_kernel_names[kernel], tlb_map_names[map],
+			 BENCH_FP_ARG(ns),
+			 BENCH_FP_ARG(bench_ns_per_op(job.misses,
+						      job.accesses)));
+	else
+		PR_DEBUG("%-6s %-10s: " BENCH_FP_FMT " ns/access, "
+			 "dTLB misses n/a\n", tlb_kernel_names[kernel],
+			 tlb_map_names[map], BENCH_FP_ARG(ns));
+out:
+	bench_run_free(run);
+	return err;
+}
+
+/*
+ * debug_pagealloc and friends split the direct map down to 4 KiB, then both
+ * mappings are the same and the numbers say nothing.
+ */
+static void tlb_check_direct(struct tlb_table *table)
+{
+#ifdef CONFIG_X86
+	unsigned int i, level, split = 0;
+	unsigned long addr;
+
+	for (i = 0; i < table->nr_chunks; i++) {
+		addr = (unsigned long)table->chunks[TLB_MAP_DIRECT][i];
+		if (!lookup_address(addr, &level) || level == PG_LEVEL_4K)
+			split++;
+	}
+	if (split)
+		PR_ERROR("%u of %u chunks are mapped with 4K pages in the "
+			 "direct map\n", split, table->nr_chunks);
+#endif
+}
+
+static int __init tlb_bench_init(void)
+{
+	struct tlb_table table = { };
+	unsigned int nr_chunks;
+	int kernel, map, err;
+
+	nr_chunks = DIV_ROUND_UP((unsigned long)size_mb << 20, TLB_CHUNK_SIZE);
+	if (!nr_chunks || !chase_accesses || !stream_passes ||
+	    nr_chunks * TLB_CHUNK_LINES > U32_MAX)
+		return -EINVAL;
+
+	err = tlb_table_alloc(&table, nr_chunks);
+	if (err) {
+		/* Order-9 pages may be gone on a fragmented box */
+		PR_ERROR("failed to allocate %u MiB\n", size_mb);
+		goto out;
+	}
+	tlb_table_link(&table);
+	tlb_check_direct(&table);
+
+	PR_DEBUG("%u MiB table, %lu lines, %lu dependent loads, %u passes\n",
+		 size_mb, table.nr_lines, chase_accesses, stream_passes);
+	for (kernel = 0; kernel < TLB_NR_KERNELS; kernel++) {
+		for (map = 0; map < TLB_NR_MAPS; map++) {
+			err = tlb_measure(&table, kernel, map);
+			if (err)
+				goto out;
+		}
+	}
+
+out:
+	tlb_table_free(&table);
+	return err;
+}
+
+static void __exit tlb_bench_exit(void)
+{
+	PR_DEBUG("module unloaded\n");
+}
+
+module_init(tlb_bench_init);
+module_exit(tlb_bench_exit);
+
+MODULE_AUTHOR("Bruno E. O. Meneguele <bmeneguele@gmail.com>");
+MODULE_DESCRIPTION("TLB miss cost of 4 KiB versus 2 MiB kernel mappings");
+MODULE_LICENSE("GPL");
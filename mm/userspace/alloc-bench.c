@@ -0,0 +1,333 @@
+/*
+ * Copyright (c) 2026 Bruno E. O. Meneguele <bmeneguele@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 2 as published by the
+ * Free Software Foundation.
+ *
+ * Userspace driver for the mm/ allocators: obj-pool.c, arena.c and buddy.c are
+ * built from the very same sources as the modules, on top of shim/, so their
+ * fast paths can be iterated on under perf, sanitizers or a debugger without
+ * loading anything. Every thread plays a CPU.
+ *
+ * $ make
+ * $ ./alloc-bench -t 4 -n 1000000 -s 64 -b 16
+ * $ make clean && make CFLAGS="-O1 -g -fsanitize=address,undefined"
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "obj-pool.h"
+#include "arena.h"
+#include "buddy.h"
+
+#define MAX_THREADS	SHIM_NR_CPUS
+#define MAX_BATCH	4096
+/* Orders used by the buddy benchmark, cycled through */
+#define BUDDY_ORDERS	4
+
+enum bench_mode {
+	BENCH_MALLOC,
+	BENCH_OBJ_POOL,
+	BENCH_ARENA,
+	BENCH_BUDDY,
+	BENCH_NR_MODES,
+};
+
+static const char * const bench_names[] = {
+	[BENCH_MALLOC]		= "malloc",
+	[BENCH_OBJ_POOL]	= "obj_pool",
+	[BENCH_ARENA]		= "arena",
+	[BENCH_BUDDY]		= "buddy",
+};
+
+static unsigned int nr_threads = 1;
+static unsigned long iters = 1000000;
+static unsigned int obj_size = 64;
+static unsigned int batch = 16;
+
+static struct obj_pool pool;
+static struct buddy buddy;
+static pthread_barrier_t start_barrier;
+
+struct bench_thread {
+	pthread_t tid;
+	unsigned int cpu;
+	enum bench_mode mode;
+	uint64_t ns;
+	uint64_t ops;
+	int err;
+};
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* Touch the objects like a user would, and keep the compiler honest */
+static inline void touch(void *obj)
+{
+	*(volatile char *)obj = 1;
+}
+
+/*
+ * Every run allocates 'batch' objects and frees them again, 'iters' in total,
+ * the last round may be short. On failure the partial batch is given back and
+ * only the complete rounds are counted.
+ */
+static int run_malloc(void **objs, uint64_t *ops)
+{
+	unsigned long r, n;
+	unsigned int i;
+	int err = 0;
+
+	for (r = 0; r < iters && !err; r += n) {
+		n = min(batch, iters - r);
+		for (i = 0; i < n; i++) {
+			objs[i] = malloc(obj_size);
+			if (!objs[i]) {
+				err = -ENOMEM;
+				break;
+			}
+			touch(objs[i]);
+		}
+		if (!err)
+			*ops += n;
+		while (i--)
+			free(objs[i]);
+	}
+	return err;
+}
+
+static int run_obj_pool(void **objs, uint64_t *ops)
+{
+	unsigned long r, n;
+	unsigned int i;
+	int err = 0;
+
+	for (r = 0; r < iters && !err; r += n) {
+		n = min(batch, iters - r);
+		for (i = 0; i < n; i++) {
+			objs[i] = obj_pool_alloc(&pool, GFP_KERNEL);
+			if (!objs[i]) {
+				err = -ENOMEM;
+				break;
+			}
+			touch(objs[i]);
+		}
+		if (!err)
+			*ops += n;
+		while (i--)
+			obj_pool_free(&pool, objs[i]);
+	}
+	return err;
+}
+
+static int run_arena(void **objs, uint64_t *ops)
+{
+	unsigned long r, n;
+	unsigned int i;
+	struct arena a;
+	int err = 0;
+
+	arena_init(&a, 2, GFP_KERNEL);
+	for (r = 0; r < iters && !err; r += n) {
+		n = min(batch, iters - r);
+		for (i = 0; i < n; i++) {
+			objs[i] = arena_alloc(&a, obj_size, sizeof(long));
+			if (!objs[i]) {
+				err = -ENOMEM;
+				break;
+			}
+			touch(objs[i]);
+		}
+		if (!err)
+			*ops += n;
+		arena_reset(&a);
+	}
+	arena_destroy(&a);
+	return err;
+}
+
+static int run_buddy(void **objs, uint64_t *ops)
+{
+	unsigned int i, order;
+	unsigned long r, n;
+	int err = 0;
+
+	for (r = 0; r < iters && !err; r += n) {
+		n = min(batch, iters - r);
+		order = (r / batch) % BUDDY_ORDERS;
+		for (i = 0; i < n; i++) {
+			objs[i] = buddy_alloc(&buddy, order);
+			if (!objs[i]) {
+				err = -ENOMEM;
+				break;
+			}
+		}
+		if (!err)
+			*ops += n;
+		while (i--)
+			buddy_free(&buddy, objs[i], order);
+	}
+	return err;
+}
+
+static void *bench_thread_fn(void *arg)
+{
+	struct bench_thread *bt = arg;
+	uint64_t start;
+	void **objs;
+
+	/* Thread n is CPU n in every run, the pool magazines are reused */
+	shim_bind_cpu(bt->cpu);
+	objs = calloc(batch, sizeof(*objs));
+	if (!objs) {
+		bt->err = -ENOMEM;
+		pthread_barrier_wait(&start_barrier);
+		return NULL;
+	}
+
+	pthread_barrier_wait(&start_barrier);
+	start = now_ns();
+	switch (bt->mode) {
+	case BENCH_MALLOC:
+		bt->err = run_malloc(objs, &bt->ops);
+		break;
+	case BENCH_OBJ_POOL:
+		bt->err = run_obj_pool(objs, &bt->ops);
+		break;
+	case BENCH_ARENA:
+		bt->err = run_arena(objs, &bt->ops);
+		break;
+	case BENCH_BUDDY:
+		bt->err = run_buddy(objs, &bt->ops);
+		break;
+	default:
+		bt->err = -EINVAL;
+	}
+	bt->ns = now_ns() - start;
+
+	free(objs);
+	return NULL;
+}
+
+static int bench_run(enum bench_mode mode, struct bench_thread *threads)
+{
+	uint64_t ns = 0, ops = 0;
+	unsigned int t;
+	int err = 0;
+
+	pthread_barrier_init(&start_barrier, NULL, nr_threads);
+	for (t = 0; t < nr_threads; t++) {
+		threads[t].cpu = t;
+		threads[t].mode = mode;
+		threads[t].ops = 0;
+		threads[t].err = 0;
+		if (pthread_create(&threads[t].tid, NULL, bench_thread_fn,
+				   &threads[t])) {
+			fprintf(stderr, "failed to create thread %u\n", t);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	for (t = 0; t < nr_threads; t++) {
+		pthread_join(threads[t].tid, NULL);
+		if (threads[t].err)
+			err = threads[t].err;
+		ns += threads[t].ns;
+		ops += threads[t].ops;
+	}
+	pthread_barrier_destroy(&start_barrier);
+
+	if (err) {
+		fprintf(stderr, "%s failed: %d\n", bench_names[mode], err);
+		return err;
+	}
+
+	/* Per-thread time per op, and all ops over the average thread time */
+	printf("%-10s %8.2f ns/op %10.2f Mops/s\n", bench_names[mode],
+	       (double)ns / ops, (double)ops * nr_threads * 1000 / ns);
+	return 0;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr, "usage: %s [-t threads] [-n iters] [-s obj_size] "
+		"[-b batch]\n", prog);
+	exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[])
+{
+	struct bench_thread threads[MAX_THREADS];
+	struct obj_pool_stats stats;
+	struct kmem_cache *cache;
+	size_t region_size;
+	void *region;
+	int mode, opt, err;
+
+	while ((opt = getopt(argc, argv, "t:n:s:b:")) != -1) {
+		switch (opt) {
+		case 't':
+			nr_threads = strtoul(optarg, NULL, 0);
+			break;
+		case 'n':
+			iters = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			obj_size = strtoul(optarg, NULL, 0);
+			break;
+		case 'b':
+			batch = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (!nr_threads || nr_threads > MAX_THREADS || !iters || !obj_size ||
+	    !batch || batch > MAX_BATCH)
+		usage(argv[0]);
+
+	cache = kmem_cache_create("alloc_bench", obj_size, 0, 0, NULL);
+	if (!cache || obj_pool_init(&pool, "alloc-bench", cache, 64)) {
+		fprintf(stderr, "failed to set up the object pool\n");
+		return EXIT_FAILURE;
+	}
+
+	/* Room for every thread holding a batch of the largest order */
+	region_size = (size_t)nr_threads * batch * PAGE_SIZE <<
+		      (BUDDY_ORDERS - 1);
+	region = aligned_alloc(PAGE_SIZE, region_size);
+	if (!region || buddy_init(&buddy, "alloc-bench", region, region_size)) {
+		fprintf(stderr, "failed to set up the buddy allocator\n");
+		return EXIT_FAILURE;
+	}
+
+	printf("%u threads, %lu ops per thread, %u bytes objects, batch %u\n",
+	       nr_threads, iters, obj_size, batch);
+	for (mode = 0; mode < BENCH_NR_MODES; mode++) {
+		err = bench_run(mode, threads);
+		if (err)
+			return EXIT_FAILURE;
+	}
+
+	obj_pool_get_stats(&pool, &stats);
+	printf("obj_pool: %lu hits, %lu misses, depot %u full/%u empty\n",
+	       stats.hits, stats.misses, stats.nr_full, stats.nr_empty);
+	printf("shrinker: %lu objects reclaimed\n", shim_shrink(~0UL));
+
+	buddy_destroy(&buddy);
+	free(region);
+	obj_pool_destroy(&pool);
+	kmem_cache_destroy(cache);
+	return 0;
+}
@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2026 Bruno E. O. Meneguele <bmeneguele@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 2 as published by the
+ * Free Software Foundation.
+ *
+ * Benchmark for mm/mmap-buf.ko: moves data in and out of the kernel buffer
+ * through read()/write() copies and through the mmap()'ed buffer directly.
+ *
+ * $ gcc -O2 -o mmap-bench mmap-bench.c
+ * $ sudo ./mmap-bench [/dev/mmap-buf]
+ *
+ * The device is only accessible by root.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/mman.h>
+
+#define MIN_SIZE	(4UL << 10)
+#define MAX_SIZE	(64UL << 20)
+/* Bytes moved per measurement, whatever the transfer size */
+#define BYTES_PER_RUN	(1UL << 30)
+
+/* Keeps the compiler from dropping the consumer loops */
+static volatile uint64_t sink;
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* Stands for whatever the application does with the data */
+static uint64_t consume(const uint64_t *data, size_t size)
+{
+	uint64_t sum = 0;
+	size_t i;
+
+	for (i = 0; i < size / sizeof(*data); i++)
+		sum += data[i];
+	return sum;
+}
+
+static void produce(uint64_t *data, size_t size, uint64_t seed)
+{
+	size_t i;
+
+	for (i = 0; i < size / sizeof(*data); i++)
+		data[i] = seed + i;
+}
+
+static double gbps(size_t size, unsigned long iters, uint64_t ns)
+{
+	return (double)size * iters / ns;
+}
+
+int main(int argc, char *argv[])
+{
+	const char *path = argc > 1 ? argv[1] : "/dev/mmap-buf";
+	unsigned long i, iters;
+	uint64_t start, t_read, t_write, t_mread, t_mwrite;
+	size_t size, dev_size;
+	uint64_t *ubuf, *map;
+	off_t end;
+	int fd;
+
+	fd = open(path, O_RDWR);
+	if (fd < 0) {
+		perror("failed to open device (root only)");
+		return -errno;
+	}
+
+	end = lseek(fd, 0, SEEK_END);
+	if (end < 0) {
+		perror("failed to get the buffer size");
+		return -errno;
+	}
+	dev_size = end;
+	if (dev_size > MAX_SIZE)
+		dev_size = MAX_SIZE;
+
+	map = mmap(NULL, dev_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (map == MAP_FAILED) {
+		perror("failed to mmap the device");
+		return -errno;
+	}
+
+	ubuf = aligned_alloc(4096, dev_size);
+	if (!ubuf) {
+		fprintf(stderr, "not enough memory\n");
+		return -ENOMEM;
+	}
+	/* Fault everything in before measuring */
+	memset(ubuf, 0, dev_size);
+	sink = consume(map, dev_size);
+
+	printf("%10s %12s %12s %12s %12s  (GB/s)\n", "size", "read()",
+	       "mmap read", "write()", "mmap write");
+
+	for (size = MIN_SIZE; size <= dev_size; size *= 2) {
+		iters = BYTES_PER_RUN / size;
+		if (!iters)
+			iters = 1;
+
+		/* Kernel to user: copy_to_user() and then use the data */
+		start = now_ns();
+		for (i = 0; i < iters; i++) {
+			if (pread(fd, ubuf, size, 0) != (ssize_t)size) {
+				perror("read failed");
+				return -errno;
+			}
+			sink += consume(ubuf, size);
+		}
+		t_read = now_ns() - start;
+
+		start = now_ns();
+		for (i = 0; i < iters; i++)
+			sink += consume(map, size);
+		t_mread = now_ns() - start;
+
+		/* User to kernel: build the data and copy_from_user() it */
+		start = now_ns();
+		for (i = 0; i < iters; i++) {
+			produce(ubuf, size, i);
+			if (pwrite(fd, ubuf, size, 0) != (ssize_t)size) {
+				perror("write failed");
+				return -errno;
+			}
+		}
+		t_write = now_ns() - start;
+
+		start = now_ns();
+		for (i = 0; i < iters; i++)
+			produce(map, size, i);
+		t_mwrite = now_ns() - start;
+
+		printf("%10zu %12.2f %12.2f %12.2f %12.2f\n", size,
+		       gbps(size, iters, t_read), gbps(size, iters, t_mread),
+		       gbps(size, iters, t_write), gbps(size, iters, t_mwrite));
+	}
+
+	free(ubuf);
+	munmap(map, dev_size);
+	close(fd);
+	return 0;
+}
@@ -0,0 +1,538 @@
+/*
+ * Copyright (c) 2026 Bruno E. O. Meneguele <bmeneguele@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 2 as published by the
+ * Free Software Foundation.
+ */
+
+#ifndef __KERNEL_SHIM_H
+#define __KERNEL_SHIM_H
+
+/*
+ * Just enough of the kernel API for the mm/ allocators (obj-pool.c, arena.c
+ * and buddy.c) to build, untouched, into a regular userspace program. Every
+ * <linux/...> header they include lands here, see the linux/ directory.
+ *
+ * - Memory comes from the libc allocator, a kmem_cache is a size and a ctor.
+ * - A "CPU" is a thread: the first per-CPU access of a thread gives it its own
+ *   slot, up to SHIM_NR_CPUS threads, unless shim_bind_cpu() picked one. Two
+ *   running threads never share a slot, hence local_lock is a no-op just like
+ *   a preemption disable is for a bound kthread.
+ * - spinlock_t is a test-and-test-and-set lock.
+ * - Shrinkers are kept in a list, shim_shrink() plays the memory pressure.
+ * - debugfs files are not created, printk goes to stderr.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <stdarg.h>
+
+/* Types */
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int8_t s8;
+typedef int16_t s16;
+typedef int32_t s32;
+typedef int64_t s64;
+
+typedef unsigned int gfp_t;
+typedef unsigned int slab_flags_t;
+
+#define __percpu
+/* Module init/exit functions are never called */
+#define __init			__attribute__((__unused__))
+#define __exit			__attribute__((__unused__))
+#ifndef __always_inline
+#define __always_inline		inline __attribute__((__always_inline__))
+#endif
+#define __packed		__attribute__((__packed__))
+
+#define U32_MAX			((u32)~0U)
+
+/* Compiler */
+
+#define likely(x)		__builtin_expect(!!(x), 1)
+#define unlikely(x)		__builtin_expect(!!(x), 0)
+#define READ_ONCE(x)		(*(const volatile typeof(x) *)&(x))
+#define WRITE_ONCE(x, val)	(*(volatile typeof(x) *)&(x) = (val))
+#define barrier()		__asm__ __volatile__("" : : : "memory")
+#if defined(__x86_64__) || defined(__i386__)
+#define cpu_relax()		__builtin_ia32_pause()
+#else
+#define cpu_relax()		barrier()
+#endif
+
+/* Module boilerplate: the trailing ';' needs a declaration to end */
+#define EXPORT_SYMBOL(sym)	extern int __shim_unused
+#define EXPORT_SYMBOL_GPL(sym)	extern int __shim_unused
+#define MODULE_AUTHOR(s)	extern int __shim_unused
+#define MODULE_DESCRIPTION(s)	extern int __shim_unused
+#define MODULE_LICENSE(s)	extern int __shim_unused
+#define module_init(fn)		extern int __shim_unused
+#define module_exit(fn)		extern int __shim_unused
+
+/* kernel.h */
+
+#define ARRAY_SIZE(a)		(sizeof(a) / sizeof((a)[0]))
+#define ALIGN(x, a)		(((x) + ((typeof(x))(a) - 1)) & \
+				 ~((typeof(x))(a) - 1))
+#define DIV_ROUND_UP(n, d)	(((n) + (d) - 1) / (d))
+#define container_of(ptr, type, member) \
+	((type *)((char *)(ptr) - offsetof(type, member)))
+#define min(a, b)		((a) < (b) ? (a) : (b))
+#define max(a, b)		((a) > (b) ? (a) : (b))
+#define min_t(t, a, b)		min((t)(a), (t)(b))
+#define max_t(t, a, b)		max((t)(a), (t)(b))
+#define swap(a, b) \
+	do { typeof(a) __tmp = (a); (a) = (b); (b) = __tmp; } while (0)
+
+#define check_add_overflow(a, b, d)	__builtin_add_overflow(a, b, d)
+
+static inline u64 div_u64(u64 dividend, u32 divisor)
+{
+	return dividend / divisor;
+}
+
+static inline u64 div64_u64(u64 dividend, u64 divisor)
+{
+	return dividend / divisor;
+}
+
+#define KERN_ERR		""
+#define KERN_NOTICE		""
+#define printk(fmt, ...)	fprintf(stderr, fmt, ##__VA_ARGS__)
+
+#define WARN_ON(cond) ({						\
+	bool __c = !!(cond);						\
+	if (unlikely(__c))						\
+		fprintf(stderr, "WARNING at %s:%d\n", __FILE__, __LINE__); \
+	unlikely(__c);							\
+})
+
+/* Atomics */
+
+typedef struct {
+	long counter;
+} atomic_long_t;
+
+#define atomic_long_read(v)	__atomic_load_n(&(v)->counter, __ATOMIC_RELAXED)
+#define atomic_long_set(v, i) \
+	__atomic_store_n(&(v)->counter, (i), __ATOMIC_RELAXED)
+#define atomic_long_add(i, v) \
+	((void)__atomic_fetch_add(&(v)->counter, (i), __ATOMIC_RELAXED))
+#define atomic_long_inc(v)	atomic_long_add(1, v)
+
+/* Lists */
+
+struct list_head {
+	struct list_head *next, *prev;
+};
+
+#define LIST_HEAD_INIT(name)	{ &(name), &(name) }
+#define LIST_HEAD(name)		struct list_head name = LIST_HEAD_INIT(name)
+
+static inline void INIT_LIST_HEAD(struct list_head *list)
+{
+	list->next = list;
+	list->prev = list;
+}
+
+static inline void __list_add(struct list_head *new, struct list_head *prev,
+			      struct list_head *next)
+{
+	next->prev = new;
+	new->next = next;
+	new->prev = prev;
+	prev->next = new;
+}
+
+static inline void list_add(struct list_head *new, struct list_head *head)
+{
+	__list_add(new, head, head->next);
+}
+
+static inline void list_add_tail(struct list_head *new,
+				 struct list_head *head)
+{
+	__list_add(new, head->prev, head);
+}
+
+static inline void list_del(struct list_head *entry)
+{
+	entry->next->prev = entry->prev;
+	entry->prev->next = entry->next;
+	entry->next = NULL;
+	entry->prev = NULL;
+}
+
+static inline void list_move(struct list_head *list, struct list_head *head)
+{
+	list->next->prev = list->prev;
+	list->prev->next = list->next;
+	list_add(list, head);
+}
+
+static inline bool list_empty(const struct list_head *head)
+{
+	return head->next == head;
+}
+
+static inline void list_splice_init(struct list_head *list,
+				    struct list_head *head)
+{
+	if (list_empty(list))
+		return;
+	list->next->prev = head;
+	list->prev->next = head->next;
+	head->next->prev = list->prev;
+	head->next = list->next;
+	INIT_LIST_HEAD(list);
+}
+
+#define list_entry(ptr, type, member)	container_of(ptr, type, member)
+#define list_first_entry(ptr, type, member) \
+	list_entry((ptr)->next, type, member)
+#define list_last_entry(ptr, type, member) \
+	list_entry((ptr)->prev, type, member)
+#define list_first_entry_or_null(ptr, type, member) \
+	(!list_empty(ptr) ? list_first_entry(ptr, type, member) : NULL)
+#define list_next_entry(pos, member) \
+	list_entry((pos)->member.next, typeof(*(pos)), member)
+#define list_for_each_entry(pos, head, member)				\
+	for (pos = list_first_entry(head, typeof(*pos), member);	\
+	     &pos->member != (head);					\
+	     pos = list_next_entry(pos, member))
+#define list_for_each_entry_safe(pos, n, head, member)			\
+	for (pos = list_first_entry(head, typeof(*pos), member),	\
+	     n = list_next_entry(pos, member);				\
+	     &pos->member != (head);					\
+	     pos = n, n = list_next_entry(n, member))
+
+/* Locking */
+
+typedef struct {
+	int locked;
+} spinlock_t;
+
+static inline void spin_lock_init(spinlock_t *lock)
+{
+	lock->locked = 0;
+}
+
+static inline void spin_lock(spinlock_t *lock)
+{
+	while (__atomic_exchange_n(&lock->locked, 1, __ATOMIC_ACQUIRE))
+		while (__atomic_load_n(&lock->locked, __ATOMIC_RELAXED))
+			cpu_relax();
+}
+
+static inline void spin_unlock(spinlock_t *lock)
+{
+	__atomic_store_n(&lock->locked, 0, __ATOMIC_RELEASE);
+}
+
+typedef struct {
+	int unused;
+} local_lock_t;
+
+#define local_lock_init(l)	((void)(l))
+#define local_lock(l)		((void)(l))
+#define local_unlock(l)		((void)(l))
+
+/* Per-CPU */
+
+#define SHIM_NR_CPUS		64
+#define SHIM_CACHELINE		64
+
+int __shim_cpu_register(void);
+extern __thread int __shim_cpu;
+
+static inline int smp_processor_id(void)
+{
+	if (unlikely(__shim_cpu < 0))
+		__shim_cpu = __shim_cpu_register();
+	return __shim_cpu;
+}
+
+/* Like kthread_bind(), the caller makes sure nobody else runs on 'cpu' */
+static inline void shim_bind_cpu(int cpu)
+{
+	__shim_cpu = cpu;
+}
+
+#define raw_smp_processor_id()	smp_processor_id()
+#define numa_node_id()		0
+#define cpu_to_node(cpu)	0
+#define for_each_possible_cpu(cpu) \
+	for ((cpu) = 0; (cpu) < SHIM_NR_CPUS; (cpu)++)
+
+/* Every slot starts on its own cacheline, no false sharing between CPUs */
+#define __shim_pcpu_stride(size)	ALIGN((size_t)(size), SHIM_CACHELINE)
+#define alloc_percpu(type) \
+	((type *)__shim_alloc_percpu(__shim_pcpu_stride(sizeof(type))))
+#define free_percpu(ptr)	free(ptr)
+
+/* Zeroed, as the kernel one */
+static inline void *__shim_alloc_percpu(size_t stride)
+{
+	void *p = aligned_alloc(SHIM_CACHELINE, stride * SHIM_NR_CPUS);
+
+	if (p)
+		memset(p, 0, stride * SHIM_NR_CPUS);
+	return p;
+}
+#define per_cpu_ptr(ptr, cpu) \
+	((typeof(ptr))((char *)(ptr) + \
+		       __shim_pcpu_stride(sizeof(*(ptr))) * (cpu)))
+#define this_cpu_ptr(ptr)	per_cpu_ptr(ptr, smp_processor_id())
+
+/* Page allocator */
+
+#define PAGE_SHIFT		12
+#define PAGE_SIZE		(1UL << PAGE_SHIFT)
+#define PAGE_ALIGNED(addr)	(!((unsigned long)(addr) & (PAGE_SIZE - 1)))
+#define MAX_PAGE_ORDER		10
+
+#define __GFP_NOWARN		0x1U
+#define __GFP_ZERO		0x2U
+#define __GFP_NORETRY		0x4U
+#define __GFP_COMP		0x8U
+#define GFP_KERNEL		0x10U
+#define GFP_NOWAIT		0x20U
+#define GFP_ATOMIC		0x40U
+
+static inline unsigned int get_order(unsigned long size)
+{
+	unsigned int order = 0;
+
+	size = (size - 1) >> PAGE_SHIFT;
+	while (size) {
+		order++;
+		size >>= 1;
+	}
+	return order;
+}
+
+static inline unsigned long __get_free_pages(gfp_t gfp, unsigned int order)
+{
+	void *p = aligned_alloc(PAGE_SIZE, PAGE_SIZE << order);
+
+	if (p && (gfp & __GFP_ZERO))
+		memset(p, 0, PAGE_SIZE << order);
+	return (unsigned long)p;
+}
+
+static inline void free_pages(unsigned long addr, unsigned int order)
+{
+	free((void *)addr);
+}
+
+/* Slab */
+
+#define SLAB_HWCACHE_ALIGN	0x1U
+#define SLAB_NO_MERGE		0x2U
+
+struct kmem_cache {
+	const char *name;
+	size_t size;
+	size_t align;
+	void (*ctor)(void *obj);
+};
+
+static inline void *kmalloc(size_t size, gfp_t gfp)
+{
+	return (gfp & __GFP_ZERO) ? calloc(1, size) : malloc(size);
+}
+
+#define kmalloc_node(size, gfp, node)	kmalloc(size, gfp)
+#define kzalloc(size, gfp)		kmalloc(size, (gfp) | __GFP_ZERO)
+#define kcalloc(n, size, gfp)		calloc(n, size)
+#define kmalloc_array(n, size, gfp)	malloc((n) * (size))
+#define kvmalloc_array(n, size, gfp)	malloc((n) * (size))
+#define kfree(p)			free((void *)(p))
+#define kvfree(p)			free((void *)(p))
+
+static inline struct kmem_cache *kmem_cache_create(const char *name,
+						   unsigned int size,
+						   unsigned int align,
+						   slab_flags_t flags,
+						   void (*ctor)(void *))
+{
+	struct kmem_cache *s = calloc(1, sizeof(*s));
+
+	if (!s)
+		return NULL;
+	if (flags & SLAB_HWCACHE_ALIGN)
+		align = max_t(unsigned int, align, SHIM_CACHELINE);
+	s->name = name;
+	s->align = max_t(size_t, align, sizeof(void *));
+	s->size = ALIGN((size_t)size, s->align);
+	s->ctor = ctor;
+	return s;
+}
+
+static inline void kmem_cache_destroy(struct kmem_cache *s)
+{
+	free(s);
+}
+
+static inline unsigned int kmem_cache_size(struct kmem_cache *s)
+{
+	return s->size;
+}
+
+static inline void *kmem_cache_alloc(struct kmem_cache *s, gfp_t gfp)
+{
+	void *obj = aligned_alloc(s->align, s->size);
+
+	if (obj && s->ctor)
+		s->ctor(obj);
+	return obj;
+}
+
+static inline void kmem_cache_free(struct kmem_cache *s, void *obj)
+{
+	free(obj);
+}
+
+static inline int kmem_cache_alloc_bulk(struct kmem_cache *s, gfp_t gfp,
+					size_t nr, void **objs)
+{
+	size_t i;
+
+	for (i = 0; i < nr; i++) {
+		objs[i] = kmem_cache_alloc(s, gfp);
+		if (!objs[i]) {
+			while (i--)
+				kmem_cache_free(s, objs[i]);
+			return 0;
+		}
+	}
+	return nr;
+}
+
+static inline void kmem_cache_free_bulk(struct kmem_cache *s, size_t nr,
+					void **objs)
+{
+	while (nr--)
+		kmem_cache_free(s, objs[nr]);
+}
+
+/* Bitmaps */
+
+#define BITS_PER_LONG		(8 * sizeof(long))
+#define BITS_TO_LONGS(nr)	DIV_ROUND_UP(nr, BITS_PER_LONG)
+#define BIT_WORD(nr)		((nr) / BITS_PER_LONG)
+#define BIT_MASK(nr)		(1UL << ((nr) % BITS_PER_LONG))
+
+static inline unsigned long *bitmap_zalloc(unsigned int nbits, gfp_t gfp)
+{
+	return calloc(BITS_TO_LONGS(nbits), sizeof(unsigned long));
+}
+
+static inline void bitmap_free(unsigned long *bitmap)
+{
+	free(bitmap);
+}
+
+static inline void __set_bit(unsigned long nr, unsigned long *addr)
+{
+	addr[BIT_WORD(nr)] |= BIT_MASK(nr);
+}
+
+static inline void __clear_bit(unsigned long nr, unsigned long *addr)
+{
+	addr[BIT_WORD(nr)] &= ~BIT_MASK(nr);
+}
+
+static inline bool test_bit(unsigned long nr, const unsigned long *addr)
+{
+	return addr[BIT_WORD(nr)] & BIT_MASK(nr);
+}
+
+static inline unsigned long find_next_bit(const unsigned long *addr,
+					  unsigned long size,
+					  unsigned long offset)
+{
+	unsigned long word;
+
+	if (offset >= size)
+		return size;
+
+	word = addr[BIT_WORD(offset)] & (~0UL << (offset % BITS_PER_LONG));
+	offset -= offset % BITS_PER_LONG;
+	while (!word) {
+		offset += BITS_PER_LONG;
+		if (offset >= size)
+			return size;
+		word = addr[BIT_WORD(offset)];
+	}
+	return min(offset + __builtin_ctzl(word), size);
+}
+
+/* Shrinkers */
+
+#define SHRINK_STOP		(~0UL)
+#define SHRINK_EMPTY		(~0UL - 1)
+
+struct shrink_control {
+	gfp_t gfp_mask;
+	int nid;
+	unsigned long nr_to_scan;
+	unsigned long nr_scanned;
+};
+
+struct shrinker {
+	unsigned long (*count_objects)(struct shrinker *,
+				       struct shrink_control *sc);
+	unsigned long (*scan_objects)(struct shrinker *,
+				      struct shrink_control *sc);
+	void *private_data;
+	struct list_head list;
+	char name[64];
+};
+
+struct shrinker *shrinker_alloc(unsigned int flags, const char *fmt, ...);
+void shrinker_register(struct shrinker *shrinker);
+void shrinker_free(struct shrinker *shrinker);
+
+/* Ask every shrinker to give back up to 'nr_to_scan' objects */
+unsigned long shim_shrink(unsigned long nr_to_scan);
+
+/* debugfs and seq_file */
+
+struct dentry;
+
+struct seq_file {
+	FILE *file;
+	void *private;
+};
+
+struct file_operations {
+	int (*show)(struct seq_file *m, void *v);
+};
+
+#define DEFINE_SHOW_ATTRIBUTE(__name)					\
+	static const struct file_operations __name##_fops		\
+		__attribute__((__unused__)) = { .show = __name##_show }
+
+#define debugfs_create_dir(name, parent)	((struct dentry *)NULL)
+#define debugfs_create_file(name, mode, parent, data, fops) \
+	((void)(data), (void)(fops), (struct dentry *)NULL)
+#define debugfs_remove(d)			((void)(d))
+#define debugfs_remove_recursive(d)		((void)(d))
+
+#define seq_printf(m, fmt, ...)	fprintf((m)->file, fmt, ##__VA_ARGS__)
+#define seq_puts(m, s)		fputs(s, (m)->file)
+#define seq_putc(m, c)		fputc(c, (m)->file)
+
+#endif /* __KERNEL_SHIM_H */
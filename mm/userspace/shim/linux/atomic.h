@@ -0,0 +1,7 @@
+/* Userspace stand-in for <linux/atomic.h>, see ../kernel-shim.h */
+#ifndef __SHIM_LINUX_ATOMIC_H
+#define __SHIM_LINUX_ATOMIC_H
+
+#include "../kernel-shim.h"
+
+#endif /* __SHIM_LINUX_ATOMIC_H */
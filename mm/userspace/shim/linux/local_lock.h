@@ -0,0 +1,7 @@
+/* Userspace stand-in for <linux/local_lock.h>, see ../kernel-shim.h */
+#ifndef __SHIM_LINUX_LOCAL_LOCK_H
+#define __SHIM_LINUX_LOCAL_LOCK_H
+
+#include "../kernel-shim.h"
+
+#endif /* __SHIM_LINUX_LOCAL_LOCK_H */
@@ -0,0 +1,7 @@
+/* Userspace stand-in for <linux/seq_file.h>, see ../kernel-shim.h */
+#ifndef __SHIM_LINUX_SEQ_FILE_H
+#define __SHIM_LINUX_SEQ_FILE_H
+
+#include "../kernel-shim.h"
+
+#endif /* __SHIM_LINUX_SEQ_FILE_H */
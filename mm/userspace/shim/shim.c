@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2026 Bruno E. O. Meneguele <bmeneguele@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 2 as published by the
+ * Free Software Foundation.
+ */
+
+#include <pthread.h>
+
+#include "kernel-shim.h"
+
+__thread int __shim_cpu = -1;
+static int shim_nr_cpus;
+
+static LIST_HEAD(shim_shrinkers);
+static pthread_mutex_t shim_shrinkers_lock = PTHREAD_MUTEX_INITIALIZER;
+
+int __shim_cpu_register(void)
+{
+	int cpu = __atomic_fetch_add(&shim_nr_cpus, 1, __ATOMIC_RELAXED);
+
+	/* Two threads on the same slot would corrupt the per-CPU data */
+	if (cpu >= SHIM_NR_CPUS) {
+		fprintf(stderr, "more than %d threads using per-CPU data\n",
+			SHIM_NR_CPUS);
+		abort();
+	}
+	return cpu;
+}
+
+struct shrinker *shrinker_alloc(unsigned int flags, const char *fmt, ...)
+{
+	struct shrinker *shrinker;
+	va_list args;
+
+	shrinker = calloc(1, sizeof(*shrinker));
+	if (!shrinker)
+		return NULL;
+
+	va_start(args, fmt);
+	vsnprintf(shrinker->name, sizeof(shrinker->name), fmt, args);
+	va_end(args);
+	INIT_LIST_HEAD(&shrinker->list);
+	return shrinker;
+}
+
+void shrinker_register(struct shrinker *shrinker)
+{
+	pthread_mutex_lock(&shim_shrinkers_lock);
+	list_add_tail(&shrinker->list, &shim_shrinkers);
+	pthread_mutex_unlock(&shim_shrinkers_lock);
+}
+
+void shrinker_free(struct shrinker *shrinker)
+{
+	if (!shrinker)
+		return;
+
+	pthread_mutex_lock(&shim_shrinkers_lock);
+	if (!list_empty(&shrinker->list))
+		list_del(&shrinker->list);
+	pthread_mutex_unlock(&shim_shrinkers_lock);
+	free(shrinker);
+}
+
+/* Same contract as do_shrink_slab(), without the batching */
+unsigned long shim_shrink(unsigned long nr_to_scan)
+{
+	struct shrink_control sc = { .gfp_mask = GFP_KERNEL };
+	unsigned long count, freed = 0, ret;
+	struct shrinker *shrinker;
+
+	pthread_mutex_lock(&shim_shrinkers_lock);
+	list_for_each_entry(shrinker, &shim_shrinkers, list) {
+		count = shrinker->count_objects(shrinker, &sc);
+		if (!count || count == SHRINK_EMPTY)
+			continue;
+
+		sc.nr_to_scan = min(count, nr_to_scan);
+		sc.nr_scanned = sc.nr_to_scan;
+		ret = shrinker->scan_objects(shrinker, &sc);
+		if (ret != SHRINK_STOP)
+			freed += ret;
+	}
+	pthread_mutex_unlock(&shim_shrinkers_lock);
+	return freed;
+}
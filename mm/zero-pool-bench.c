@@ -0,0 +1,194 @@
+/*
+ * Copyright (c) 2026 Bruno E. O. Meneguele <bmeneguele@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 2 as published by the
+ * Free Software Foundation.
+ */
+
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/kernel.h>
+#include <linux/gfp.h>
+#include <linux/mm.h>
+#include <linux/string.h>
+#include <linux/sort.h>
+#include <linux/delay.h>
+#include <linux/ktime.h>
+#include <linux/topology.h>
+
+#include "utils.h"
+#include "bench.h"
+#include "zero-pool.h"
+
+/*
+ * Latency of getting a zeroed page: alloc_page(__GFP_ZERO) against a
+ * zero_pool. Pages are held 'batch' at a time, written to like a user would,
+ * then freed, and the benchmark sleeps 'interval_us' between batches: that's
+ * the idle time the pool kthread gets to refill the reserve. With no idle
+ * time at all the pool degrades to the page allocator, misses are reported.
+ *
+ * Example, after loading zero-pool.ko:
+ * insmod zero-pool-bench.ko bench_iters=1000000 batch=32 interval_us=50
+ */
+static unsigned int bench_iters = 100000;
+module_param(bench_iters, uint, 0444);
+MODULE_PARM_DESC(bench_iters, "Zeroed pages allocated per mode");
+
+static unsigned int batch = 64;
+module_param(batch, uint, 0444);
+MODULE_PARM_DESC(batch, "Pages held before freeing them");
+
+static unsigned int interval_us = 100;
+module_param(interval_us, uint, 0444);
+MODULE_PARM_DESC(interval_us, "Sleep between batches in microseconds");
+
+static unsigned int low = 256;
+module_param(low, uint, 0444);
+MODULE_PARM_DESC(low, "Reserve size below which the kthread refills it");
+
+static unsigned int high = 1024;
+module_param(high, uint, 0444);
+MODULE_PARM_DESC(high, "Reserve size the kthread refills up to");
+
+#define ZERO_BENCH_MAX_BATCH	4096
+
+enum zero_bench_mode {
+	ZERO_BENCH_DIRECT,
+	ZERO_BENCH_POOL,
+	ZERO_BENCH_NR_MODES,
+};
+
+static const char * const zero_bench_names[] = {
+	[ZERO_BENCH_DIRECT]	= "__GFP_ZERO",
+	[ZERO_BENCH_POOL]	= "zero_pool",
+};
+
+static struct zero_pool bench_pool;
+
+static int zero_bench_cmp(const void *a, const void *b)
+{
+	u64 x = *(const u64 *)a, y = *(const u64 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static struct page *zero_bench_alloc(enum zero_bench_mode mode)
+{
+	if (mode == ZERO_BENCH_POOL)
+		return zero_pool_alloc(&bench_pool, GFP_KERNEL);
+	return alloc_page(GFP_KERNEL | __GFP_ZERO);
+}
+
+static int zero_bench_run(enum zero_bench_mode mode, u64 *samples,
+			  struct page **pages)
+{
+	unsigned int i, n, held = 0;
+	u64 start, sum = 0;
+	int err = 0;
+
+	for (i = 0; i < bench_iters && !err; i += n) {
+		n = min(batch, bench_iters - i);
+		for (held = 0; held < n; held++) {
+			start = ktime_get_ns();
+			pages[held] = zero_bench_alloc(mode);
+			samples[i + held] = ktime_get_ns() - start;
+			if (!pages[held]) {
+				err = -ENOMEM;
+				break;
+			}
+			/* Not timed: whatever we got must be clean */
+			if (memchr_inv(page_address(pages[held]), 0,
+				       PAGE_SIZE)) {
+				PR_ERROR("%s returned a dirty page\n",
+					 zero_bench_names[mode]);
+				err = -EIO;
+				held++;
+				break;
+			}
+			memset(page_address(pages[held]), 0xa5, 64);
+		}
+		while (held)
+			__free_page(pages[--held]);
+		usleep_range(interval_us, interval_us + interval_us / 4 + 1);
+	}
+	if (err)
+		return err;
+
+	for (i = 0; i < bench_iters; i++)
+		sum += samples[i];
+	sort(samples, bench_iters, sizeof(*samples), zero_bench_cmp, NULL);
+	PR_DEBUG("%-10s: avg " BENCH_FP_FMT " ns, p50 %llu ns, p90 %llu ns, "
+		 "p99 %llu ns, max %llu ns\n", zero_bench_names[mode],
+		 BENCH_FP_ARG(bench_ns_per_op(sum, bench_iters)),
+		 samples[bench_iters / 2], samples[bench_iters * 9 / 10],
+		 samples[bench_iters * 99 / 100], samples[bench_iters - 1]);
+	return 0;
+}
+
+static int __init zero_bench_init(void)
+{
+	struct zero_pool_stats stats;
+	struct page **pages;
+	unsigned int tries;
+	u64 *samples;
+	int err;
+
+	if (!bench_iters || !batch || batch > ZERO_BENCH_MAX_BATCH)
+		return -EINVAL;
+
+	samples = kvmalloc_array(bench_iters, sizeof(*samples), GFP_KERNEL);
+	pages = kmalloc_array(batch, sizeof(*pages), GFP_KERNEL);
+	if (!samples || !pages) {
+		err = -ENOMEM;
+		goto out;
+	}
+
+	err = zero_pool_init(&bench_pool, "zero-pool-bench", numa_node_id(),
+			     low, high);
+	if (err)
+		goto out;
+
+	PR_DEBUG("%u pages, batch %u, %u us between batches, reserve %u-%u\n",
+		 bench_iters, batch, interval_us, low, high);
+	err = zero_bench_run(ZERO_BENCH_DIRECT, samples, pages);
+	if (err)
+		goto out_pool;
+
+	/* Start with a full reserve, up to a second */
+	for (tries = 0; tries < 100; tries++) {
+		zero_pool_get_stats(&bench_pool, &stats);
+		if (stats.nr >= high)
+			break;
+		msleep(10);
+	}
+
+	err = zero_bench_run(ZERO_BENCH_POOL, samples, pages);
+	if (err)
+		goto out_pool;
+
+	zero_pool_get_stats(&bench_pool, &stats);
+	PR_DEBUG("zero_pool: %lu hits, %lu misses, %lu pages zeroed by the "
+		 "kthread\n", stats.hits, stats.misses, stats.zeroed);
+out_pool:
+	zero_pool_destroy(&bench_pool);
+out:
+	if (err)
+		PR_ERROR("benchmark failed: %d\n", err);
+	kfree(pages);
+	kvfree(samples);
+	return err;
+}
+
+static void __exit zero_bench_exit(void)
+{
+	PR_DEBUG("module unloaded\n");
+}
+
+module_init(zero_bench_init);
+module_exit(zero_bench_exit);
+
+MODULE_AUTHOR("Bruno E. O. Meneguele <bmeneguele@gmail.com>");
+MODULE_DESCRIPTION("Pre-zeroed page reserve versus __GFP_ZERO latency");
+MODULE_LICENSE("GPL");
@@ -0,0 +1,261 @@
+/*
+ * Copyright (c) 2026 Bruno E. O. Meneguele <bmeneguele@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 2 as published by the
+ * Free Software Foundation.
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/gfp.h>
+#include <linux/mm.h>
+#include <linux/highmem.h>
+#include <linux/kthread.h>
+#include <linux/sched.h>
+#include <linux/sched/types.h>
+#include <linux/topology.h>
+#include <linux/jiffies.h>
+#include <linux/shrinker.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+
+#include "utils.h"
+#include "zero-pool.h"
+
+/* No refill for this long after the shrinker took pages away, or after an
+ * allocation failure */
+#define ZERO_POOL_BACKOFF	HZ
+
+static struct dentry *zero_pool_debugfs;
+
+struct page *zero_pool_alloc(struct zero_pool *pool, gfp_t gfp)
+{
+	struct page *page;
+	unsigned long flags;
+	bool refill;
+
+	spin_lock_irqsave(&pool->lock, flags);
+	page = list_first_entry_or_null(&pool->pages, struct page, lru);
+	if (page) {
+		list_del(&page->lru);
+		pool->nr--;
+	}
+	refill = pool->nr < pool->low;
+	spin_unlock_irqrestore(&pool->lock, flags);
+
+	if (refill)
+		wake_up(&pool->wait);
+
+	if (page) {
+		atomic_long_inc(&pool->hits);
+		return page;
+	}
+	atomic_long_inc(&pool->misses);
+	return alloc_pages_node(pool->nid, gfp | __GFP_ZERO, 0);
+}
+EXPORT_SYMBOL_GPL(zero_pool_alloc);
+
+static bool zero_pool_backoff(struct zero_pool *pool)
+{
+	return time_before(jiffies,
+			   READ_ONCE(pool->backoff_at) + ZERO_POOL_BACKOFF);
+}
+
+/*
+ * Fill the reserve up to 'high'. __GFP_NORETRY: a reserve isn't worth
+ * reclaiming for, the hot path still has the page allocator to fall back to.
+ */
+static void zero_pool_refill(struct zero_pool *pool)
+{
+	struct page *page;
+
+	while (READ_ONCE(pool->nr) < pool->high && !kthread_should_stop()) {
+		if (zero_pool_backoff(pool)) {
+			/* kthread_stop() wakes us up */
+			schedule_timeout_interruptible(ZERO_POOL_BACKOFF);
+			continue;
+		}
+
+		page = alloc_pages_node(pool->nid, GFP_KERNEL | __GFP_NORETRY |
+					__GFP_NOWARN, 0);
+		if (!page) {
+			WRITE_ONCE(pool->backoff_at, jiffies);
+			continue;
+		}
+		/* init_on_alloc=1 already did it */
+		if (!want_init_on_alloc(GFP_KERNEL))
+			clear_highpage(page);
+		WRITE_ONCE(pool->zeroed, pool->zeroed + 1);
+
+		spin_lock_irq(&pool->lock);
+		list_add(&page->lru, &pool->pages);
+		pool->nr++;
+		spin_unlock_irq(&pool->lock);
+		cond_resched();
+	}
+}
+
+static int zero_pool_thread(void *data)
+{
+	struct sched_attr attr = { .sched_policy = SCHED_IDLE };
+	struct zero_pool *pool = data;
+
+	/* Only runs when the CPU would otherwise be idle */
+	if (sched_setattr_nocheck(current, &attr))
+		PR_ERROR("%s: failed to switch to SCHED_IDLE\n", pool->name);
+
+	while (!kthread_should_stop()) {
+		wait_event_interruptible(pool->wait,
+					 READ_ONCE(pool->nr) < pool->low ||
+					 kthread_should_stop());
+		zero_pool_refill(pool);
+	}
+	return 0;
+}
+
+static unsigned long zero_pool_shrink_count(struct shrinker *shrink,
+					    struct shrink_control *sc)
+{
+	struct zero_pool *pool = shrink->private_data;
+	unsigned int nr = READ_ONCE(pool->nr);
+
+	return nr ? nr : SHRINK_EMPTY;
+}
+
+static unsigned long zero_pool_shrink_scan(struct shrinker *shrink,
+					   struct shrink_control *sc)
+{
+	struct zero_pool *pool = shrink->private_data;
+	unsigned long freed = 0;
+	struct page *page, *tmp;
+	LIST_HEAD(reclaim);
+
+	WRITE_ONCE(pool->backoff_at, jiffies);
+	spin_lock_irq(&pool->lock);
+	while (freed < sc->nr_to_scan && pool->nr) {
+		page = list_last_entry(&pool->pages, struct page, lru);
+		list_move(&page->lru, &reclaim);
+		pool->nr--;
+		freed++;
+	}
+	spin_unlock_irq(&pool->lock);
+
+	list_for_each_entry_safe(page, tmp, &reclaim, lru) {
+		list_del(&page->lru);
+		__free_page(page);
+	}
+
+	atomic_long_add(freed, &pool->reclaimed);
+	sc->nr_scanned = freed;
+	return freed ? freed : SHRINK_STOP;
+}
+
+void zero_pool_get_stats(struct zero_pool *pool, struct zero_pool_stats *stats)
+{
+	stats->hits = atomic_long_read(&pool->hits);
+	stats->misses = atomic_long_read(&pool->misses);
+	stats->zeroed = READ_ONCE(pool->zeroed);
+	stats->reclaimed = atomic_long_read(&pool->reclaimed);
+	stats->nr = READ_ONCE(pool->nr);
+}
+EXPORT_SYMBOL_GPL(zero_pool_get_stats);
+
+static int zero_pool_stats_show(struct seq_file *m, void *v)
+{
+	struct zero_pool *pool = m->private;
+	struct zero_pool_stats stats;
+
+	zero_pool_get_stats(pool, &stats);
+	seq_printf(m, "hits %lu\nmisses %lu\nzeroed %lu\nreclaimed %lu\n"
+		   "pages %u\nlow %u\nhigh %u\n", stats.hits, stats.misses,
+		   stats.zeroed, stats.reclaimed, stats.nr, pool->low,
+		   pool->high);
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(zero_pool_stats);
+
+/*
+ * Keep between 'low' and 'high' zeroed pages from node 'nid', which may be
+ * NUMA_NO_NODE. The kthread starts filling the reserve right away.
+ */
+int zero_pool_init(struct zero_pool *pool, const char *name, int nid,
+		   unsigned int low, unsigned int high)
+{
+	if (!high || low > high)
+		return -EINVAL;
+
+	memset(pool, 0, sizeof(*pool));
+	pool->name = name;
+	pool->nid = nid;
+	pool->low = low;
+	pool->high = high;
+	spin_lock_init(&pool->lock);
+	INIT_LIST_HEAD(&pool->pages);
+	init_waitqueue_head(&pool->wait);
+	atomic_long_set(&pool->hits, 0);
+	atomic_long_set(&pool->misses, 0);
+	atomic_long_set(&pool->reclaimed, 0);
+	pool->backoff_at = jiffies - ZERO_POOL_BACKOFF;
+
+	pool->shrinker = shrinker_alloc(0, "zero-pool-%s", name);
+	if (!pool->shrinker)
+		return -ENOMEM;
+	pool->shrinker->count_objects = zero_pool_shrink_count;
+	pool->shrinker->scan_objects = zero_pool_shrink_scan;
+	pool->shrinker->private_data = pool;
+	shrinker_register(pool->shrinker);
+
+	pool->task = kthread_create_on_node(zero_pool_thread, pool, nid,
+					    "zero-pool/%s", name);
+	if (IS_ERR(pool->task)) {
+		shrinker_free(pool->shrinker);
+		return PTR_ERR(pool->task);
+	}
+	/* Clear the pages close to their memory */
+	if (nid != NUMA_NO_NODE)
+		set_cpus_allowed_ptr(pool->task, cpumask_of_node(nid));
+	wake_up_process(pool->task);
+
+	pool->debugfs = debugfs_create_file(name, 0444, zero_pool_debugfs,
+					    pool, &zero_pool_stats_fops);
+	return 0;
+}
+EXPORT_SYMBOL_GPL(zero_pool_init);
+
+void zero_pool_destroy(struct zero_pool *pool)
+{
+	struct page *page, *tmp;
+
+	debugfs_remove(pool->debugfs);
+	pool->debugfs = NULL;
+	kthread_stop(pool->task);
+	/* Waits for running scans, the list is ours after that */
+	shrinker_free(pool->shrinker);
+	pool->shrinker = NULL;
+
+	list_for_each_entry_safe(page, tmp, &pool->pages, lru) {
+		list_del(&page->lru);
+		__free_page(page);
+	}
+	pool->nr = 0;
+}
+EXPORT_SYMBOL_GPL(zero_pool_destroy);
+
+static int __init zero_pool_module_init(void)
+{
+	zero_pool_debugfs = debugfs_create_dir("zero-pool", NULL);
+	return 0;
+}
+
+static void __exit zero_pool_module_exit(void)
+{
+	debugfs_remove_recursive(zero_pool_debugfs);
+}
+
+module_init(zero_pool_module_init);
+module_exit(zero_pool_module_exit);
+
+MODULE_AUTHOR("Bruno E. O. Meneguele <bmeneguele@gmail.com>");
+MODULE_DESCRIPTION("Reserve of pages zeroed in the background");
+MODULE_LICENSE("GPL");
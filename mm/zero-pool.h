@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2026 Bruno E. O. Meneguele <bmeneguele@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 2 as published by the
+ * Free Software Foundation.
+ */
+
+#ifndef __ZERO_POOL_H
+#define __ZERO_POOL_H
+
+#include <linux/types.h>
+#include <linux/list.h>
+#include <linux/spinlock.h>
+#include <linux/wait.h>
+#include <linux/atomic.h>
+#include <linux/gfp.h>
+
+/*
+ * Reserve of already zeroed order-0 pages, so a caller needing a clean page
+ * on a latency critical path doesn't have to clear it inline like
+ * alloc_page(__GFP_ZERO) does.
+ *
+ * A SCHED_IDLE kthread per pool allocates and clears pages whenever the
+ * reserve drops below 'low', up to 'high', thus the clearing happens when the
+ * CPU has nothing better to do. When the reserve is empty zero_pool_alloc()
+ * falls back to the page allocator with __GFP_ZERO. Pages handed out are
+ * plain pages, freed with __free_page() like any other.
+ *
+ * Clearing is moved off the hot path, not avoided: the page lands in the
+ * caller's cache cold. Under memory pressure a shrinker gives the reserve
+ * back. Counters are exported as zero-pool/<name> in debugfs.
+ */
+
+struct task_struct;
+struct shrinker;
+struct dentry;
+
+struct zero_pool_stats {
+	/* Allocations served by the reserve */
+	unsigned long hits;
+	/* Allocations cleared inline, the reserve was empty */
+	unsigned long misses;
+	/* Pages cleared by the kthread */
+	unsigned long zeroed;
+	/* Pages given back by the shrinker */
+	unsigned long reclaimed;
+	unsigned int nr;
+};
+
+struct zero_pool {
+	const char *name;
+	int nid;
+	unsigned int low;
+	unsigned int high;
+
+	spinlock_t lock;
+	/* Zeroed pages, linked through page->lru */
+	struct list_head pages;
+	unsigned int nr;
+
+	struct task_struct *task;
+	wait_queue_head_t wait;
+
+	atomic_long_t hits;
+	atomic_long_t misses;
+	atomic_long_t reclaimed;
+	/* Last shrinker run or failed refill, the kthread backs off a while */
+	unsigned long backoff_at;
+	/* Only written by the kthread */
+	unsigned long zeroed;
+	struct shrinker *shrinker;
+	struct dentry *debugfs;
+};
+
+int zero_pool_init(struct zero_pool *pool, const char *name, int nid,
+		   unsigned int low, unsigned int high);
+void zero_pool_destroy(struct zero_pool *pool);
+void zero_pool_get_stats(struct zero_pool *pool, struct zero_pool_stats *stats);
+
+struct page *zero_pool_alloc(struct zero_pool *pool, gfp_t gfp);
+
+#endif /* __ZERO_POOL_H */